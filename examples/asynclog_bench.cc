@@ -0,0 +1,66 @@
+// 日志后端的吞吐量：threads个线程各打count条LOG_INFO
+// 先用默认的同步输出（写stdout，重定向到/dev/null），再接到AsyncLogging写滚动文件，比较每秒的条数和丢弃的条数，
+// 最后把运行时级别调到ERROR，看被过滤掉的LOG_INFO的开销
+// usage: ./asyncLogBench [threads] [count] [log basename]
+#include <yieldemuduo/AsyncLogging.h>
+#include <yieldemuduo/Logger.h>
+#include <yieldemuduo/Clock.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <thread>
+#include <vector>
+
+static double run(int threads, int count)
+{
+  int64_t start = MonotonicClock::nowNanos();
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([t, count]()
+                         {
+      for (int i = 0; i < count; ++i)
+      {
+        LOG_INFO("asyncLogBench thread %d message %d: abcdefghijklmnopqrstuvwxyz0123456789", t, i)
+      } });
+  }
+  for (std::thread &worker : workers)
+  {
+    worker.join();
+  }
+  double seconds = (MonotonicClock::nowNanos() - start) / 1e9;
+  return threads * count / seconds;
+}
+
+int main(int argc, char *argv[])
+{
+  int threads = argc > 1 ? atoi(argv[1]) : 4;
+  int count = argc > 2 ? atoi(argv[2]) : 200000;
+  std::string basename = argc > 3 ? argv[3] : "/tmp/asyncLogBench";
+
+  // 同步输出重定向到/dev/null，只比较前端的开销
+  int savedStdout = ::dup(STDOUT_FILENO);
+  int devNull = ::open("/dev/null", O_WRONLY);
+  ::dup2(devNull, STDOUT_FILENO);
+  double syncRate = run(threads, count);
+  ::fflush(stdout);
+  ::dup2(savedStdout, STDOUT_FILENO);
+  ::close(devNull);
+  printf("sync  stdout: %.0f msgs/s\n", syncRate);
+
+  AsyncLogging async(basename, 64 * 1024 * 1024);
+  async.start();
+  Logger::instance().setOutput([&async](const char *msg, int len)
+                               { async.append(msg, len); });
+  double asyncRate = run(threads, count);
+  Logger::instance().setOutput(nullptr);
+  async.stop();
+  printf("async file  : %.0f msgs/s, dropped %ld\n", asyncRate, async.dropped());
+
+  Logger::setLogLevel(ERROR);
+  double filteredRate = run(threads, count * 10);
+  printf("filtered    : %.2f ns/call\n", 1e9 / filteredRate);
+  return 0;
+}
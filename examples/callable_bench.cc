@@ -0,0 +1,107 @@
+// 对比std::function和InlineFunction包装常见闭包时的内存分配次数和吞吐量
+// 闭包形如std::bind(&TcpConnection::xxx, shared_from_this(), ...)，构造后移动进队列再调用
+// 最后统计其他线程通过EventLoop::queueInLoop投递同样的闭包时，每次投递的平均分配次数
+// usage: ./callableBench [count]
+#include <yieldemuduo/EventLoop.h>
+#include <yieldemuduo/InlineFunction.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+
+static std::atomic<int64_t> g_allocations(0);
+
+void *operator new(size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void *p = malloc(size);
+  if (!p)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+  free(p);
+}
+
+struct Session
+{
+  void onMessage(int id, size_t len) { bytes += id + len; }
+  size_t bytes = 0;
+};
+
+template <typename Function>
+static void run(const char *name, int count)
+{
+  std::shared_ptr<Session> session(new Session);
+  std::vector<Function> queue;
+  queue.reserve(1024);
+
+  int64_t before = g_allocations.load();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < count; i += 1024)
+  {
+    for (int j = 0; j < 1024; ++j)
+    {
+      queue.emplace_back(std::bind(&Session::onMessage, session, j, static_cast<size_t>(i)));
+    }
+    for (Function &f : queue)
+    {
+      f();
+    }
+    queue.clear();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  int64_t allocations = g_allocations.load() - before;
+  fprintf(stderr, "%-16s calls=%d  %.1f M/s  allocations per call=%.2f\n",
+          name, count, count / seconds / 1e6, static_cast<double>(allocations) / count);
+}
+
+static void runLoop(int count)
+{
+  EventLoop loop;
+  std::shared_ptr<Session> session(new Session);
+  int done = 0;
+  int64_t before = 0;
+
+  std::thread producer([&]()
+                       {
+    before = g_allocations.load();
+    for (int i = 0; i < count; ++i)
+    {
+      loop.queueInLoop([session, i, &done]()
+                       {
+        session->onMessage(i, 0);
+        ++done; });
+    }
+    loop.queueInLoop([&loop]()
+                     { loop.quit(); }); });
+  loop.loop();
+  producer.join();
+  int64_t allocations = g_allocations.load() - before;
+  fprintf(stderr, "%-16s posts=%d  allocations per post=%.3f\n", "queueInLoop", count, static_cast<double>(allocations) / count);
+}
+
+int main(int argc, char *argv[])
+{
+  int count = argc > 1 ? atoi(argv[1]) : 4 * 1024 * 1024;
+
+  run<std::function<void()>>("std::function", count);
+  run<InlineFunction<void()>>("InlineFunction", count);
+  runLoop(count / 4);
+  return 0;
+}
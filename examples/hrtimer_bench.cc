@@ -0,0 +1,85 @@
+// 亚毫秒定时器的精度，以及几种时钟读一次的开销
+// 依次设置count个延迟为delay微秒的定时器（上一个触发后设置下一个），统计实际延迟超出设定值的分布，
+// 类似重传定时器；然后比较Timestamp::now()、MonotonicClock和FastClock（TSC）的开销
+// usage: ./hrTimerBench [count] [delay us]
+#include <yieldemuduo/EventLoop.h>
+#include <yieldemuduo/Clock.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+struct Chain
+{
+  void start()
+  {
+    scheduled = MonotonicClock::now();
+    loop->runAfter(delay, [this]()
+                   { fire(); });
+  }
+  void fire()
+  {
+    lateNs.push_back((MonotonicClock::now() - scheduled - delay).count());
+    if (static_cast<int>(lateNs.size()) < count)
+    {
+      start();
+    }
+    else
+    {
+      loop->quit();
+    }
+  }
+
+  EventLoop *loop;
+  MonotonicClock::duration delay;
+  int count;
+  MonotonicClock::time_point scheduled;
+  std::vector<int64_t> lateNs;
+};
+
+template <typename F>
+static double measure(F now)
+{
+  const int kReads = 10 * 1000 * 1000;
+  int64_t sink = 0;
+  int64_t start = MonotonicClock::nowNanos();
+  for (int i = 0; i < kReads; ++i)
+  {
+    sink += now();
+  }
+  double ns = static_cast<double>(MonotonicClock::nowNanos() - start) / kReads;
+  return sink == 42 ? 0 : ns;
+}
+
+int main(int argc, char *argv[])
+{
+  int count = argc > 1 ? atoi(argv[1]) : 2000;
+  int delayUs = argc > 2 ? atoi(argv[2]) : 200;
+
+  {
+    EventLoop loop;
+    Chain chain{&loop, std::chrono::microseconds(delayUs), count, {}, {}};
+    chain.start();
+    loop.loop();
+    std::sort(chain.lateNs.begin(), chain.lateNs.end());
+    fprintf(stderr, "runAfter(%dus) x %d  late p50=%.1fus p99=%.1fus max=%.1fus\n", delayUs, count,
+            chain.lateNs[count / 2] / 1000.0, chain.lateNs[count * 99 / 100] / 1000.0, chain.lateNs.back() / 1000.0);
+  }
+
+  fprintf(stderr, "Timestamp::now      %.1f ns\n", measure([]()
+                                                         { return Timestamp::now().microSecondsSinceEpoch(); }));
+  fprintf(stderr, "MonotonicClock      %.1f ns\n", measure([]()
+                                                         { return MonotonicClock::nowNanos(); }));
+  if (FastClock::setEnabled(true))
+  {
+    fprintf(stderr, "FastClock (TSC)     %.1f ns\n", measure([]()
+                                                           { return FastClock::monotonicNanos(); }));
+    fprintf(stderr, "FastClock drift vs CLOCK_MONOTONIC: %ld ns\n", FastClock::monotonicNanos() - MonotonicClock::nowNanos());
+  }
+  else
+  {
+    fprintf(stderr, "FastClock unavailable\n");
+  }
+  return 0;
+}
@@ -0,0 +1,79 @@
+// 统计每个空闲连接占用的堆内存
+// 用socketpair模拟N个已建立的连接，分别测试默认模式和lowFootprint模式
+// usage: ./idleConnBench [N]
+#include <yieldemuduo/TcpConnection.h>
+#include <yieldemuduo/EventLoop.h>
+
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+static size_t heapInUse()
+{
+  return mallinfo2().uordblks;
+}
+
+static void run(EventLoop *loop, int n, bool lowFootprint)
+{
+  std::vector<int> peers;
+  std::vector<TcpConnectionPtr> conns;
+  peers.reserve(n);
+  conns.reserve(n);
+
+  size_t before = heapInUse();
+  for (int i = 0; i < n; ++i)
+  {
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0)
+    {
+      perror("socketpair");
+      exit(1);
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "conn#%d", i);
+    TcpConnectionPtr conn(new TcpConnection(loop, name, fds[0], InetAddress(), InetAddress(), lowFootprint));
+    conn->setConnectionCallback([](const TcpConnectionPtr &) {});
+    conn->setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp)
+                             { buf->retrieveAll(); });
+    conn->connectEstablished();
+    conns.push_back(conn);
+    peers.push_back(fds[1]);
+  }
+  size_t after = heapInUse();
+
+  fprintf(stderr, "%-12s connections=%d  heap=%zu bytes  per idle connection=%zu bytes\n",
+          lowFootprint ? "lowFootprint" : "default", n, after - before, (after - before) / n);
+
+  for (const TcpConnectionPtr &conn : conns)
+  {
+    conn->connectDestroyed();
+  }
+  conns.clear();
+  for (int fd : peers)
+  {
+    ::close(fd);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  int n = argc > 1 ? atoi(argv[1]) : 10000;
+
+  // 每个连接占用两个fd
+  struct rlimit rl;
+  ::getrlimit(RLIMIT_NOFILE, &rl);
+  rl.rlim_cur = rl.rlim_max;
+  ::setrlimit(RLIMIT_NOFILE, &rl);
+  if (rl.rlim_cur < static_cast<rlim_t>(2 * n + 64))
+  {
+    n = static_cast<int>(rl.rlim_cur / 2) - 32;
+  }
+
+  EventLoop loop;
+  run(&loop, n, false);
+  run(&loop, n, true);
+  return 0;
+}
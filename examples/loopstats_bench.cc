@@ -0,0 +1,91 @@
+// 测量EventLoop每轮迭代统计的开销，并打印线程池中所有loop汇总后的统计
+// 每轮迭代的统计是4次单调时钟读取加上6次直方图记录
+// usage: ./loopStatsBench [iterations] [round trips]
+#include <yieldemuduo/TcpServer.h>
+#include <yieldemuduo/EventLoop.h>
+#include <yieldemuduo/LoopStats.h>
+
+#include <sys/socket.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+
+static void measureOverhead(int iterations)
+{
+  LoopStats stats;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i)
+  {
+    int64_t t0 = LoopStats::nowNanos();
+    int64_t t1 = LoopStats::nowNanos();
+    int64_t t2 = LoopStats::nowNanos();
+    stats.recordIteration(t1 - t0, t2 - t1, LoopStats::nowNanos() - t2, i & 7, i & 3);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fprintf(stderr, "instrumentation overhead: %.1f ns per iteration\n", seconds * 1e9 / iterations);
+}
+
+// 每个io loop上一个每毫秒触发的定时器，用于统计定时器延迟
+static void tick(EventLoop *loop)
+{
+  loop->runAt(Timestamp(Timestamp::now().microSecondsSinceEpoch() + 1000), [loop]()
+              { tick(loop); });
+}
+
+int main(int argc, char *argv[])
+{
+  int iterations = argc > 1 ? atoi(argv[1]) : 10 * 1000 * 1000;
+  int roundTrips = argc > 2 ? atoi(argv[2]) : 20000;
+  measureOverhead(iterations);
+
+  EventLoop loop;
+  InetAddress addr(19920);
+  TcpServer server(&loop, addr, "LoopStatsBench");
+  server.setConnectionCallback([](const TcpConnectionPtr &) {});
+  server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+                            { conn->send(buf->retrieveAllAsString()); });
+  server.setThreadNum(2);
+  server.setThreadInitCallback(tick);
+  server.start();
+
+  std::thread client([&]()
+                     {
+    int fds[2];
+    for (int &fd : fds)
+    {
+      fd = ::socket(AF_INET, SOCK_STREAM, 0);
+      while (::connect(fd, (sockaddr *)addr.getSockAddr(), sizeof(sockaddr_in)) < 0)
+      {
+        usleep(10000);
+      }
+    }
+    char buf[64] = {0};
+    for (int i = 0; i < roundTrips; ++i)
+    {
+      int fd = fds[i % 2];
+      ::write(fd, buf, sizeof(buf));
+      size_t got = 0;
+      while (got < sizeof(buf))
+      {
+        ssize_t n = ::read(fd, buf + got, sizeof(buf) - got);
+        if (n <= 0)
+        {
+          break;
+        }
+        got += n;
+      }
+    }
+    for (int fd : fds)
+    {
+      ::close(fd);
+    }
+    usleep(100 * 1000);
+    fprintf(stderr, "%s", server.threadPool()->statsSnapshot().toString().c_str());
+    loop.queueInLoop([&loop]()
+                     { loop.quit(); }); });
+
+  loop.loop();
+  client.join();
+  return 0;
+}
@@ -0,0 +1,85 @@
+// 测量64字节ping-pong的往返延迟，对比默认模式和EventLoop低延迟（busy-poll）模式的p50/p99
+// 客户端每次发一个消息，收到完整回复后再发下一个，服务端原样回显
+// 低延迟模式下loop在有过活动之后的一段时间内以0超时轮询，省去epoll_wait阻塞和唤醒的开销，代价是空转占用CPU；
+// 单核机器上空转会和客户端线程争抢CPU，结果反而变差
+// usage: ./pingPongBench [count] [busy poll us] [SO_BUSY_POLL us]
+#include <yieldemuduo/TcpServer.h>
+#include <yieldemuduo/EventLoop.h>
+
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static void run(const char *name, uint16_t port, int count, int busyPollUs, int socketBusyPollUs)
+{
+  EventLoop loop;
+  loop.setBusyPoll(busyPollUs);
+  loop.setSocketBusyPoll(socketBusyPollUs);
+  InetAddress addr(port);
+  TcpServer server(&loop, addr, "PingPongBench");
+
+  server.setConnectionCallback([](const TcpConnectionPtr &) {});
+  server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+                            { conn->send(buf->retrieveAllAsString()); });
+  server.start();
+
+  std::thread client([&]()
+                     {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    while (::connect(fd, (sockaddr *)addr.getSockAddr(), sizeof(sockaddr_in)) < 0)
+    {
+      usleep(10000);
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    char message[64] = {0};
+    char reply[64];
+    std::vector<int64_t> samples;
+    samples.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+      auto start = std::chrono::steady_clock::now();
+      ::write(fd, message, sizeof(message));
+      size_t got = 0;
+      while (got < sizeof(reply))
+      {
+        ssize_t n = ::read(fd, reply + got, sizeof(reply) - got);
+        if (n <= 0)
+        {
+          break;
+        }
+        got += n;
+      }
+      samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+    ::close(fd);
+
+    std::sort(samples.begin(), samples.end());
+    int64_t p50 = samples[samples.size() / 2];
+    int64_t p99 = samples[samples.size() * 99 / 100];
+    loop.runInLoop([&, p50, p99]()
+                   {
+      fprintf(stderr, "%-10s round trips=%d  p50=%.1fus  p99=%.1fus  spin polls=%ld\n",
+              name, count, p50 / 1000.0, p99 / 1000.0, loop.spinPolls());
+      loop.quit(); }); });
+
+  loop.loop();
+  client.join();
+}
+
+int main(int argc, char *argv[])
+{
+  int count = argc > 1 ? atoi(argv[1]) : 100000;
+  int busyPollUs = argc > 2 ? atoi(argv[2]) : 50;
+  int socketBusyPollUs = argc > 3 ? atoi(argv[3]) : 0;
+
+  run("default", 19910, count, 0, 0);
+  run("busy-poll", 19911, count, busyPollUs, socketBusyPollUs);
+  return 0;
+}
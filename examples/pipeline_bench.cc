@@ -0,0 +1,93 @@
+// 流水线小RPC压测，对比开启/关闭EventLoop写合并时的write系统调用次数
+// 客户端每批发送batch个16字节的请求，服务端对每个请求分两次send回复（4字节头 + 16字节body）
+// usage: ./pipelineBench [rounds] [batch]
+#include <yieldemuduo/TcpServer.h>
+#include <yieldemuduo/EventLoop.h>
+
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <chrono>
+
+static const size_t kRequestSize = 16;
+static const size_t kReplySize = 4 + kRequestSize;
+
+static void run(uint16_t port, int rounds, int batch, bool coalescing)
+{
+  EventLoop loop;
+  loop.setWriteCoalescing(coalescing);
+  InetAddress addr(port);
+  TcpServer server(&loop, addr, "PipelineBench");
+  int64_t sends = 0;
+
+  server.setConnectionCallback([](const TcpConnectionPtr &conn)
+                               {
+    if (conn->connected())
+    {
+      conn->setTcpNoDelay(true);
+    } });
+  server.setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+                            {
+    while (buf->readableBytes() >= kRequestSize)
+    {
+      conn->send("RPLY", 4);
+      conn->send(buf->peek(), kRequestSize);
+      buf->retrieve(kRequestSize);
+      sends += 2;
+    } });
+  server.start();
+
+  std::thread client([&]()
+                     {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    while (::connect(fd, (sockaddr *)addr.getSockAddr(), sizeof(sockaddr_in)) < 0)
+    {
+      usleep(10000);
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    std::string requests(kRequestSize * batch, 'q');
+    std::string replies(kReplySize * batch, 0);
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+      ::write(fd, requests.data(), requests.size());
+      size_t got = 0;
+      while (got < replies.size())
+      {
+        ssize_t n = ::read(fd, &replies[got], replies.size() - got);
+        if (n <= 0)
+        {
+          break;
+        }
+        got += n;
+      }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::close(fd);
+
+    loop.runInLoop([&, seconds]()
+                   {
+      int64_t writes = sends - loop.writeSyscallsSaved();
+      fprintf(stderr, "%-11s requests=%d  %.0f req/s  sends=%ld  write syscalls=%ld  saved=%ld\n",
+              coalescing ? "coalescing" : "direct", rounds * batch, rounds * batch / seconds,
+              sends, writes, loop.writeSyscallsSaved());
+      loop.quit(); }); });
+
+  loop.loop();
+  client.join();
+}
+
+int main(int argc, char *argv[])
+{
+  int rounds = argc > 1 ? atoi(argv[1]) : 2000;
+  int batch = argc > 2 ? atoi(argv[2]) : 32;
+
+  run(19880, rounds, batch, false);
+  run(19881, rounds, batch, true);
+  return 0;
+}
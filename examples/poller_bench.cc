@@ -0,0 +1,109 @@
+// 对比epoll和io_uring两种Poller后端每个请求的poller系统调用次数（epoll_wait/epoll_ctl或io_uring_enter）
+// 客户端建立conns个连接，每轮向所有连接各发一个请求，再读完所有回复；服务端对每个请求回复reply字节
+// 回复较大时服务端要开关EPOLLOUT，epoll后端在epoll_wait之前合并提交，同一轮中抵消的修改不调用epoll_ctl，
+// io_uring则合并进下一次io_uring_enter
+// usage: ./pollerBench [conns] [rounds] [reply bytes]
+#include <yieldemuduo/TcpServer.h>
+#include <yieldemuduo/EventLoop.h>
+
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+#include <chrono>
+
+static void run(const char *name, uint16_t port, int conns, int rounds, size_t replySize)
+{
+  EventLoop loop;
+  InetAddress addr(port);
+  TcpServer server(&loop, addr, "PollerBench");
+  std::string reply(replySize, 'r');
+
+  server.setConnectionCallback([](const TcpConnectionPtr &) {});
+  server.setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+                            {
+    while (buf->readableBytes() >= 8)
+    {
+      buf->retrieve(8);
+      conn->send(reply);
+    } });
+  server.start();
+
+  std::thread client([&]()
+                     {
+    std::vector<int> fds;
+    for (int i = 0; i < conns; ++i)
+    {
+      int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+      while (::connect(fd, (sockaddr *)addr.getSockAddr(), sizeof(sockaddr_in)) < 0)
+      {
+        usleep(10000);
+      }
+      fds.push_back(fd);
+    }
+    usleep(100 * 1000);
+
+    int64_t before = 0;
+    loop.runInLoop([&]()
+                   { before = loop.pollerSyscalls(); });
+    usleep(10 * 1000);
+    std::vector<char> buf(replySize);
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+      for (int fd : fds)
+      {
+        ::write(fd, "request!", 8);
+      }
+      for (int fd : fds)
+      {
+        size_t got = 0;
+        while (got < replySize)
+        {
+          ssize_t n = ::read(fd, buf.data(), replySize - got);
+          if (n <= 0)
+          {
+            break;
+          }
+          got += n;
+        }
+      }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (int fd : fds)
+    {
+      ::close(fd);
+    }
+
+    loop.runInLoop([&, seconds, before]()
+                   {
+      int64_t requests = static_cast<int64_t>(conns) * rounds;
+      int64_t syscalls = loop.pollerSyscalls() - before;
+      fprintf(stderr, "%-8s requests=%ld  %.0f req/s  poller syscalls=%ld  per request=%.3f  epoll_ctl avoided=%ld\n",
+              name, requests, requests / seconds, syscalls, static_cast<double>(syscalls) / requests, loop.pollerUpdatesAvoided());
+      loop.quit(); }); });
+
+  loop.loop();
+  client.join();
+}
+
+int main(int argc, char *argv[])
+{
+  int conns = argc > 1 ? atoi(argv[1]) : 1000;
+  int rounds = argc > 2 ? atoi(argv[2]) : 50;
+  size_t replySize = argc > 3 ? atol(argv[3]) : 256 * 1024;
+
+  struct rlimit rl;
+  ::getrlimit(RLIMIT_NOFILE, &rl);
+  rl.rlim_cur = rl.rlim_max;
+  ::setrlimit(RLIMIT_NOFILE, &rl);
+
+  // Poller后端在创建EventLoop时根据环境变量选择
+  ::unsetenv("MUDUO_USE_IOURING");
+  run("epoll", 19900, conns, rounds, replySize);
+  ::setenv("MUDUO_USE_IOURING", "1", 1);
+  run("io_uring", 19901, conns, rounds, replySize);
+  return 0;
+}
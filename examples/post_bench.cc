@@ -0,0 +1,133 @@
+// 多个线程向同一个EventLoop投递回调（queueInLoop），统计不同生产者数量下每秒投递的回调数
+// 同时输出EventLoop被请求唤醒的次数和实际写eventfd的次数
+// 作为对照，同时测试std::mutex + std::vector实现的任务队列（不经过EventLoop，只有入队和出队）
+// usage: ./postBench [posts per producer] [max producers]
+#include <yieldemuduo/EventLoop.h>
+#include <yieldemuduo/MpscQueue.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+using Clock = std::chrono::steady_clock;
+
+static double runLoop(int producers, int posts, int64_t *wakeupsRequested, int64_t *wakeupsIssued)
+{
+  EventLoop loop;
+  int64_t expect = static_cast<int64_t>(producers) * posts;
+  int64_t done = 0;
+  std::vector<std::thread> threads;
+
+  auto start = Clock::now();
+  for (int p = 0; p < producers; ++p)
+  {
+    threads.emplace_back([&]()
+                         {
+      for (int i = 0; i < posts; ++i)
+      {
+        loop.queueInLoop([&]()
+                         {
+          if (++done == expect)
+          {
+            loop.quit();
+          } });
+      } });
+  }
+  loop.loop();
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  for (std::thread &t : threads)
+  {
+    t.join();
+  }
+  *wakeupsRequested = loop.wakeupsRequested();
+  *wakeupsIssued = loop.wakeupsIssued();
+  return expect / seconds;
+}
+
+template <typename Queue>
+static double runQueue(int producers, int posts)
+{
+  Queue queue;
+  int64_t expect = static_cast<int64_t>(producers) * posts;
+  int64_t done = 0;
+  std::vector<std::thread> threads;
+
+  auto start = Clock::now();
+  for (int p = 0; p < producers; ++p)
+  {
+    threads.emplace_back([&]()
+                         {
+      for (int i = 0; i < posts; ++i)
+      {
+        queue.push([&]()
+                   { ++done; });
+      } });
+  }
+  while (done < expect)
+  {
+    queue.drain();
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  for (std::thread &t : threads)
+  {
+    t.join();
+  }
+  return expect / seconds;
+}
+
+struct MutexQueue
+{
+  void push(std::function<void()> f)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    functors.emplace_back(std::move(f));
+  }
+  void drain()
+  {
+    std::vector<std::function<void()>> local;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      local.swap(functors);
+    }
+    for (auto &f : local)
+    {
+      f();
+    }
+  }
+  std::mutex mutex;
+  std::vector<std::function<void()>> functors;
+};
+
+struct LockFreeQueue
+{
+  void push(std::function<void()> f) { queue.push(std::move(f)); }
+  void drain()
+  {
+    queue.consume([](std::function<void()> &f)
+                  { f(); });
+  }
+  MpscQueue<std::function<void()>> queue;
+};
+
+int main(int argc, char *argv[])
+{
+  int posts = argc > 1 ? atoi(argv[1]) : 200000;
+  int maxProducers = argc > 2 ? atoi(argv[2]) : 16;
+
+  fprintf(stderr, "%-10s %16s %12s %12s %16s %16s\n", "producers", "EventLoop/s", "wakeups", "eventfd", "mpsc queue/s", "mutex queue/s");
+  for (int producers = 1; producers <= maxProducers; producers *= 2)
+  {
+    int64_t requested = 0;
+    int64_t issued = 0;
+    double loopRate = runLoop(producers, posts, &requested, &issued);
+    double mpscRate = runQueue<LockFreeQueue>(producers, posts);
+    double mutexRate = runQueue<MutexQueue>(producers, posts);
+    fprintf(stderr, "%-10d %16.0f %12ld %12ld %16.0f %16.0f\n", producers, loopRate, requested, issued, mpscRate, mutexRate);
+  }
+  return 0;
+}
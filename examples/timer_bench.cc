@@ -0,0 +1,61 @@
+// 在loop线程中保持1M个未到期的定时器，测量添加、取消的速率，以及稳态下添加+取消一对的速率
+// 取消的顺序是随机的，模拟连接的超时定时器在超时前被取消
+// usage: ./timerBench [outstanding] [pairs]
+#include <yieldemuduo/EventLoop.h>
+#include <yieldemuduo/TimerId.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+static double elapsed(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+  int outstanding = argc > 1 ? atoi(argv[1]) : 1000 * 1000;
+  int pairs = argc > 2 ? atoi(argv[2]) : 1000 * 1000;
+
+  EventLoop loop;
+  std::mt19937 rng(12345);
+  std::uniform_int_distribution<int> delay(100, 10000);
+  int fired = 0;
+  std::vector<TimerId> ids;
+  ids.reserve(outstanding);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < outstanding; ++i)
+  {
+    ids.push_back(loop.runAfter(delay(rng), [&fired]()
+                                { ++fired; }));
+  }
+  double seconds = elapsed(start);
+  fprintf(stderr, "schedule     %d timers  %.2f M/s\n", outstanding, outstanding / seconds / 1e6);
+
+  std::uniform_int_distribution<int> pick(0, outstanding - 1);
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < pairs; ++i)
+  {
+    TimerId &id = ids[pick(rng)];
+    loop.cancel(id);
+    id = loop.runAfter(delay(rng), [&fired]()
+                       { ++fired; });
+  }
+  seconds = elapsed(start);
+  fprintf(stderr, "cancel+add   %d pairs   %.2f M/s  (%d outstanding)\n", pairs, pairs / seconds / 1e6, outstanding);
+
+  std::shuffle(ids.begin(), ids.end(), rng);
+  start = std::chrono::steady_clock::now();
+  for (const TimerId &id : ids)
+  {
+    loop.cancel(id);
+  }
+  seconds = elapsed(start);
+  fprintf(stderr, "cancel       %d timers  %.2f M/s  fired=%d\n", outstanding, outstanding / seconds / 1e6, fired);
+  return 0;
+}
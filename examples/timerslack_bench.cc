@@ -0,0 +1,66 @@
+// 大量到期时间相近的定时器下timerfd_settime的调用次数：不设slack、设置slack、用poll超时代替timerfd
+// 每个定时器触发后在50~150ms之后重新设置自己，类似连接的重传定时器
+// usage: ./timerSlackBench [timers] [seconds] [slack us]
+#include <yieldemuduo/EventLoop.h>
+#include <yieldemuduo/LoopStats.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include <vector>
+
+struct Retransmit
+{
+  void schedule()
+  {
+    int64_t delayUs = 50 * 1000 + static_cast<int64_t>((*rng)() % (100 * 1000));
+    loop->runAt(Timestamp(Timestamp::now().microSecondsSinceEpoch() + delayUs), [this]()
+                { fire(); });
+  }
+  void fire()
+  {
+    ++*fired;
+    schedule();
+  }
+
+  EventLoop *loop;
+  std::mt19937 *rng;
+  int64_t *fired;
+};
+
+static void run(const char *name, int timers, int seconds, int slackUs, bool pollTimeout)
+{
+  EventLoop loop;
+  loop.setTimerSlack(slackUs);
+  loop.setTimerPollTimeout(pollTimeout);
+  std::mt19937 rng(12345);
+  int64_t fired = 0;
+  std::vector<Retransmit> retransmits(timers, Retransmit{&loop, &rng, &fired});
+  for (Retransmit &r : retransmits)
+  {
+    r.schedule();
+  }
+
+  int64_t armsBefore = loop.timerArms();
+  loop.runAfter(seconds, [&loop]()
+                { loop.quit(); });
+  loop.loop();
+
+  LoopStatsSnapshot stats;
+  loop.stats()->snapshot(&stats);
+  int64_t arms = loop.timerArms() - armsBefore;
+  fprintf(stderr, "%-14s fired=%ld/s  timerfd_settime=%ld/s  timer lag p50=%luus p99=%luus\n",
+          name, fired / seconds, arms / seconds, stats.timerLagUs.percentile(50), stats.timerLagUs.percentile(99));
+}
+
+int main(int argc, char *argv[])
+{
+  int timers = argc > 1 ? atoi(argv[1]) : 10000;
+  int seconds = argc > 2 ? atoi(argv[2]) : 3;
+  int slackUs = argc > 3 ? atoi(argv[3]) : 1000;
+
+  run("no slack", timers, seconds, 0, false);
+  run("slack", timers, seconds, slackUs, false);
+  run("poll timeout", timers, seconds, 0, true);
+  return 0;
+}
@@ -0,0 +1,78 @@
+// 测量跟踪埋点关闭和开启时每个区间的开销，然后跟踪一段echo往返，导出Chrome trace-event JSON
+// 导出的文件可以用Perfetto（ui.perfetto.dev）或chrome://tracing打开
+// usage: ./traceBench [spans] [round trips] [output]
+#include <yieldemuduo/TcpServer.h>
+#include <yieldemuduo/EventLoop.h>
+#include <yieldemuduo/Tracer.h>
+
+#include <sys/socket.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+
+static double measure(int spans)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < spans; ++i)
+  {
+    TraceSpan span("bench", i);
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e9 / spans;
+}
+
+int main(int argc, char *argv[])
+{
+  int spans = argc > 1 ? atoi(argv[1]) : 10 * 1000 * 1000;
+  int roundTrips = argc > 2 ? atoi(argv[2]) : 1000;
+  const char *output = argc > 3 ? argv[3] : "trace.json";
+
+  Tracer::setEnabled(false);
+  double disabled = measure(spans);
+  Tracer::setEnabled(true);
+  double enabled = measure(spans);
+  fprintf(stderr, "span cost: disabled=%.2f ns  enabled=%.2f ns\n", disabled, enabled);
+  Tracer::clear();
+
+  EventLoop loop;
+  InetAddress addr(19940);
+  TcpServer server(&loop, addr, "TraceBench");
+  server.setConnectionCallback([](const TcpConnectionPtr &) {});
+  server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+                            { conn->send(buf->retrieveAllAsString()); });
+  server.setThreadNum(1);
+  server.start();
+
+  std::thread client([&]()
+                     {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    while (::connect(fd, (sockaddr *)addr.getSockAddr(), sizeof(sockaddr_in)) < 0)
+    {
+      usleep(10000);
+    }
+    char buf[64] = {0};
+    for (int i = 0; i < roundTrips; ++i)
+    {
+      ::write(fd, buf, sizeof(buf));
+      size_t got = 0;
+      while (got < sizeof(buf))
+      {
+        ssize_t n = ::read(fd, buf + got, sizeof(buf) - got);
+        if (n <= 0)
+        {
+          break;
+        }
+        got += n;
+      }
+    }
+    ::close(fd);
+    usleep(100 * 1000);
+    Tracer::setEnabled(false);
+    fprintf(stderr, "trace written to %s: %s\n", output, Tracer::dump(output) ? "ok" : "failed");
+    loop.queueInLoop([&loop]()
+                     { loop.quit(); }); });
+
+  loop.loop();
+  client.join();
+  return 0;
+}
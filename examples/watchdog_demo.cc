@@ -0,0 +1,70 @@
+// 演示LoopWatchdog：服务端的消息回调和投递回调各卡住一段时间，看门狗报告卡顿的fd、连接名、回调和调用栈
+// usage: ./watchdogDemo [threshold ms] [stall ms]
+#include <yieldemuduo/TcpServer.h>
+#include <yieldemuduo/EventLoop.h>
+#include <yieldemuduo/LoopWatchdog.h>
+
+#include <sys/socket.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+static void slowHandler(int stallMs)
+{
+  usleep(stallMs * 1000);
+}
+
+int main(int argc, char *argv[])
+{
+  int thresholdMs = argc > 1 ? atoi(argv[1]) : 50;
+  int stallMs = argc > 2 ? atoi(argv[2]) : 200;
+
+  EventLoop loop;
+  InetAddress addr(19930);
+  TcpServer server(&loop, addr, "WatchdogDemo");
+  LoopWatchdog watchdog(thresholdMs);
+  watchdog.setStallCallback([](const StallReport &report)
+                            {
+    fprintf(stderr, "stall %ld ms fd=%d owner=%s functor=%s\n", report.stalledMs, report.fd,
+            report.owner.c_str(), report.functor.c_str());
+    for (const std::string &frame : report.backtrace)
+    {
+      fprintf(stderr, "    %s\n", frame.c_str());
+    } });
+
+  server.setConnectionCallback([](const TcpConnectionPtr &) {});
+  server.setMessageCallback([stallMs](const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+                            {
+    slowHandler(stallMs);
+    conn->send(buf->retrieveAllAsString()); });
+  server.setThreadNum(1);
+  server.setThreadInitCallback([&watchdog](EventLoop *ioLoop)
+                               { watchdog.watch(ioLoop); });
+  server.start();
+  watchdog.watch(&loop);
+  watchdog.start();
+
+  std::thread client([&]()
+                     {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    while (::connect(fd, (sockaddr *)addr.getSockAddr(), sizeof(sockaddr_in)) < 0)
+    {
+      usleep(10000);
+    }
+    char buf[16] = "ping";
+    ::write(fd, buf, sizeof(buf));
+    ::read(fd, buf, sizeof(buf));
+    ::close(fd);
+
+    loop.queueInLoop([stallMs]()
+                     { slowHandler(stallMs); });
+    usleep((stallMs + 100) * 1000);
+    fprintf(stderr, "stalls detected=%ld\n", watchdog.stallsDetected());
+    watchdog.stop();
+    loop.queueInLoop([&loop]()
+                     { loop.quit(); }); });
+
+  loop.loop();
+  client.join();
+  return 0;
+}
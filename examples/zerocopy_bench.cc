@@ -0,0 +1,80 @@
+// 在loopback上验证MSG_ZEROCOPY发送模式
+// 服务端向客户端发送count个size字节的消息，分别测试普通模式和zerocopy模式
+// 输出吞吐量以及zerocopy的发送次数、完成通知次数和内核退化为拷贝的次数
+// loopback上内核总是会拷贝数据（copied == completions），真实网卡上copied应接近0
+// usage: ./zeroCopyBench [size] [count]
+#include <yieldemuduo/TcpServer.h>
+#include <yieldemuduo/EventLoop.h>
+
+#include <sys/socket.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <chrono>
+
+static void run(uint16_t port, size_t size, int count, bool zeroCopy)
+{
+  EventLoop loop;
+  InetAddress addr(port);
+  TcpServer server(&loop, addr, "ZeroCopyBench");
+  TcpConnectionPtr conn;
+
+  server.setConnectionCallback([&](const TcpConnectionPtr &c)
+                               {
+    if (!c->connected())
+    {
+      return;
+    }
+    conn = c;
+    c->setZeroCopyThreshold(zeroCopy ? size : 0);
+    for (int i = 0; i < count; ++i)
+    {
+      c->send(std::string(size, 'z'));
+    } });
+  server.start();
+
+  std::thread client([&]()
+                     {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    while (::connect(fd, (sockaddr *)addr.getSockAddr(), sizeof(sockaddr_in)) < 0)
+    {
+      usleep(10000);
+    }
+    auto start = std::chrono::steady_clock::now();
+    size_t total = 0;
+    size_t expect = size * count;
+    char buf[256 * 1024];
+    while (total < expect)
+    {
+      ssize_t n = ::read(fd, buf, sizeof(buf));
+      if (n <= 0)
+      {
+        break;
+      }
+      total += n;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    // 等待剩余的完成通知
+    usleep(100 * 1000);
+    loop.runInLoop([&, total, seconds]()
+                   {
+      fprintf(stderr, "%-8s received=%zu bytes  %.1f MB/s  zerocopy sends=%ld completions=%ld copied=%ld pinned=%zu\n",
+              zeroCopy ? "zerocopy" : "copy", total, total / seconds / 1024 / 1024,
+              conn->zeroCopySends(), conn->zeroCopyCompletions(), conn->zeroCopyCopied(), conn->zeroCopyPinnedBlocks());
+      conn.reset();
+      loop.quit(); });
+    ::close(fd); });
+
+  loop.loop();
+  client.join();
+}
+
+int main(int argc, char *argv[])
+{
+  size_t size = argc > 1 ? atol(argv[1]) : 4 * 1024 * 1024;
+  int count = argc > 2 ? atoi(argv[2]) : 256;
+
+  run(19870, size, count, false);
+  run(19871, size, count, true);
+  return 0;
+}
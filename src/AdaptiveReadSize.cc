@@ -0,0 +1,77 @@
+#include "AdaptiveReadSize.h"
+
+#include <algorithm>
+
+namespace
+{
+  // 16 ~ 496按16递增，512之后按2倍递增
+  // 编译期生成的常量表，其他编译单元在静态初始化阶段构造AdaptiveReadSize（如全局的TcpServer）时也能使用
+  struct SizeTable
+  {
+    static const int kSize = 31 + 22; // 16 ~ 496共31项，512 ~ 1G共22项
+    const size_t *begin() const { return values; }
+    const size_t *end() const { return values + kSize; }
+    size_t operator[](int index) const { return values[index]; }
+    size_t values[kSize];
+  };
+
+  constexpr SizeTable createSizeTable()
+  {
+    SizeTable table{};
+    int n = 0;
+    for (size_t i = 16; i < 512; i += 16)
+    {
+      table.values[n++] = i;
+    }
+    for (size_t i = 512; i <= (1 << 30); i <<= 1)
+    {
+      table.values[n++] = i;
+    }
+    return table;
+  }
+
+  constexpr SizeTable kSizeTable = createSizeTable();
+}
+
+AdaptiveReadSize::AdaptiveReadSize()
+    : minIndex_(sizeTableIndex(kMinimum)),
+      maxIndex_(sizeTableIndex(kMaximum)),
+      index_(sizeTableIndex(kInitial)),
+      nextReadSize_(kSizeTable[index_]),
+      decreaseNow_(false)
+{
+}
+
+void AdaptiveReadSize::record(size_t actualReadBytes)
+{
+  if (actualReadBytes <= kSizeTable[std::max(0, index_ - kIndexDecrement)])
+  {
+    if (decreaseNow_)
+    {
+      index_ = std::max(index_ - kIndexDecrement, minIndex_);
+      nextReadSize_ = kSizeTable[index_];
+      decreaseNow_ = false;
+    }
+    else
+    {
+      decreaseNow_ = true;
+    }
+  }
+  else if (actualReadBytes >= nextReadSize_)
+  {
+    index_ = std::min(index_ + kIndexIncrement, maxIndex_);
+    nextReadSize_ = kSizeTable[index_];
+    decreaseNow_ = false;
+  }
+}
+
+// 二分查找第一个不小于size的表项
+int AdaptiveReadSize::sizeTableIndex(size_t size)
+{
+  auto it = std::lower_bound(kSizeTable.begin(), kSizeTable.end(), size);
+  if (it == kSizeTable.end())
+  {
+    return SizeTable::kSize - 1;
+  }
+  return static_cast<int>(it - kSizeTable.begin());
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "copyable.h"
+
+#include <stddef.h>
+
+// 根据最近几次read的实际大小预测下一次read的大小，参考netty的AdaptiveRecvByteBufAllocator
+// 读满了预测值则快速增大（跳4级），连续两次都小于低一级的大小才缓慢减小（降1级）
+// 连接用预测值来扩大/收缩inputBuffer_，使大多数read直接落在buffer_中
+class AdaptiveReadSize : public copyable
+{
+public:
+  static const size_t kMinimum = 64;
+  static const size_t kInitial = 1024;
+  static const size_t kMaximum = 65536;
+
+  AdaptiveReadSize();
+
+  size_t guess() const { return nextReadSize_; }
+  void record(size_t actualReadBytes);
+
+private:
+  static const int kIndexIncrement = 4;
+  static const int kIndexDecrement = 1;
+
+  static int sizeTableIndex(size_t size);
+
+  int minIndex_;
+  int maxIndex_;
+  int index_;
+  size_t nextReadSize_;
+  bool decreaseNow_;
+};
@@ -0,0 +1,146 @@
+#include "AsyncLogging.h"
+#include "LogFile.h"
+
+#include <stdio.h>
+#include <chrono>
+
+AsyncLogging::AsyncLogging(const std::string &basename, off_t rollSize, int flushInterval, int numBuffers)
+    : basename_(basename),
+      rollSize_(rollSize),
+      flushInterval_(flushInterval),
+      running_(false),
+      dropped_(0),
+      thread_(std::bind(&AsyncLogging::threadFunc, this), "AsyncLogging"),
+      currentBuffer_(new Buffer)
+{
+  for (int i = 1; i < numBuffers || i < 2; ++i)
+  {
+    freeBuffers_.emplace_back(new Buffer);
+  }
+  buffers_.reserve(numBuffers);
+}
+
+AsyncLogging::~AsyncLogging()
+{
+  if (running_)
+  {
+    stop();
+  }
+}
+
+void AsyncLogging::append(const char *logline, int len)
+{
+  // 放不进一个空缓冲区的日志直接丢弃
+  if (len <= 0 || static_cast<size_t>(len) > kBufferSize)
+  {
+    if (len != 0)
+    {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (currentBuffer_ && currentBuffer_->avail() >= static_cast<size_t>(len))
+  {
+    currentBuffer_->append(logline, len);
+    return;
+  }
+  // 当前缓冲区写满了，交给后台，换一个空的
+  if (currentBuffer_)
+  {
+    buffers_.push_back(std::move(currentBuffer_));
+    cond_.notify_one();
+  }
+  if (freeBuffers_.empty())
+  {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  currentBuffer_ = std::move(freeBuffers_.back());
+  freeBuffers_.pop_back();
+  currentBuffer_->append(logline, len);
+}
+
+void AsyncLogging::start()
+{
+  running_ = true;
+  thread_.start();
+}
+
+void AsyncLogging::stop()
+{
+  {
+    // 加锁设置，后台线程不会在检查running_之后、等待之前错过通知
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+  }
+  cond_.notify_one();
+  thread_.join();
+}
+
+void AsyncLogging::threadFunc()
+{
+  LogFile output(basename_, rollSize_);
+  BufferVector buffersToWrite;
+  int64_t reportedDropped = 0;
+  while (true)
+  {
+    bool running;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (buffers_.empty() && running_)
+      {
+        cond_.wait_for(lock, std::chrono::seconds(flushInterval_));
+      }
+      // 停止之后还要把这一批写完再退出
+      running = running_;
+      // 正在写的缓冲区也一起拿走，至少每flushInterval秒写一次
+      if (currentBuffer_ && currentBuffer_->size() > 0)
+      {
+        buffers_.push_back(std::move(currentBuffer_));
+        if (!freeBuffers_.empty())
+        {
+          currentBuffer_ = std::move(freeBuffers_.back());
+          freeBuffers_.pop_back();
+        }
+      }
+      buffersToWrite.swap(buffers_);
+    }
+
+    int64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != reportedDropped)
+    {
+      char buf[128];
+      int n = snprintf(buf, sizeof(buf), "[ERROR]AsyncLogging dropped %ld log messages\n", dropped - reportedDropped);
+      output.append(buf, n);
+      reportedDropped = dropped;
+    }
+    for (const BufferPtr &buffer : buffersToWrite)
+    {
+      output.append(buffer->data(), buffer->size());
+    }
+    output.flush();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (BufferPtr &buffer : buffersToWrite)
+      {
+        buffer->reset();
+        if (!currentBuffer_)
+        {
+          currentBuffer_ = std::move(buffer);
+        }
+        else
+        {
+          freeBuffers_.push_back(std::move(buffer));
+        }
+      }
+    }
+    buffersToWrite.clear();
+
+    if (!running)
+    {
+      break;
+    }
+  }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "nocopyable.h"
+#include "Thread.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <sys/types.h>
+
+// 异步日志后端：前端线程只把日志行拷贝进预先分配的缓冲区，后台线程交换缓冲区后批量写入滚动日志文件
+// 前端持有锁的时间只有一次memcpy，不做任何IO；后台跟不上、预分配的缓冲区都用完时丢弃日志并计数，不阻塞也不再分配
+// 用法：
+//   AsyncLogging log("server", 64 * 1024 * 1024);
+//   log.start();
+//   Logger::instance().setOutput([&log](const char *msg, int len) { log.append(msg, len); });
+class AsyncLogging : nocopyable
+{
+public:
+  static const size_t kBufferSize = 4 * 1024 * 1024;
+
+  // rollSize为单个日志文件的字节数上限，flushInterval秒至少写一次，numBuffers为预分配的缓冲区个数（至少2个）
+  AsyncLogging(const std::string &basename, off_t rollSize, int flushInterval = 3, int numBuffers = 16);
+  ~AsyncLogging();
+
+  // 可以在任意线程调用
+  void append(const char *logline, int len);
+
+  void start();
+  void stop();
+
+  int64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  class Buffer : nocopyable
+  {
+  public:
+    Buffer() : size_(0) {}
+    size_t avail() const { return sizeof(data_) - size_; }
+    void append(const char *data, size_t len)
+    {
+      memcpy(data_ + size_, data, len);
+      size_ += len;
+    }
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+    void reset() { size_ = 0; }
+
+  private:
+    char data_[kBufferSize];
+    size_t size_;
+  };
+  using BufferPtr = std::unique_ptr<Buffer>;
+  using BufferVector = std::vector<BufferPtr>;
+
+  void threadFunc();
+
+  const std::string basename_;
+  const off_t rollSize_;
+  const int flushInterval_;
+  std::atomic_bool running_;
+  std::atomic<int64_t> dropped_;
+  Thread thread_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  BufferPtr currentBuffer_; // 前端正在写的缓冲区
+  BufferVector buffers_;    // 已经写满、等待后台写入的缓冲区
+  BufferVector freeBuffers_; // 后台写完还回来的空缓冲区
+};
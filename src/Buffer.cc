@@ -1,21 +1,168 @@
 #include "Buffer.h"
 #include <sys/uio.h>
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char *allocateStorage(BufferPool *pool, size_t size)
+{
+  if (pool)
+  {
+    return pool->allocate(size);
+  }
+  char *storage = static_cast<char *>(::malloc(size));
+  if (storage == nullptr)
+  {
+    abort();
+  }
+  return storage;
+}
+
+static void freeStorage(BufferPool *pool, char *storage, size_t size)
+{
+  if (pool)
+  {
+    pool->deallocate(storage, size);
+  }
+  else
+  {
+    ::free(storage);
+  }
+}
+
+Buffer::Buffer(BufferPool *pool, size_t initialSize)
+    : pool_(pool), buffer_(nullptr), capacity_(0), readerIndex_(kCheapPrepend), writerIndex_(kCheapPrepend)
+{
+  if (initialSize > 0)
+  {
+    capacity_ = BufferPool::roundUp(kCheapPrepend + initialSize);
+    buffer_ = allocateStorage(pool_, capacity_);
+  }
+}
+
+Buffer::Buffer(const Buffer &rhs)
+    : pool_(rhs.pool_), buffer_(nullptr), capacity_(rhs.capacity_), readerIndex_(rhs.readerIndex_), writerIndex_(rhs.writerIndex_)
+{
+  if (capacity_ > 0)
+  {
+    buffer_ = allocateStorage(pool_, capacity_);
+    ::memcpy(buffer_ + readerIndex_, rhs.peek(), rhs.readableBytes());
+  }
+}
+
+Buffer::Buffer(Buffer &&rhs) noexcept
+    : pool_(rhs.pool_), buffer_(rhs.buffer_), capacity_(rhs.capacity_), readerIndex_(rhs.readerIndex_), writerIndex_(rhs.writerIndex_)
+{
+  rhs.buffer_ = nullptr;
+  rhs.capacity_ = 0;
+  rhs.readerIndex_ = kCheapPrepend;
+  rhs.writerIndex_ = kCheapPrepend;
+}
+
+Buffer &Buffer::operator=(Buffer rhs)
+{
+  swap(rhs);
+  return *this;
+}
+
+Buffer::~Buffer()
+{
+  if (buffer_)
+  {
+    freeStorage(pool_, buffer_, capacity_);
+  }
+}
+
+void Buffer::swap(Buffer &rhs)
+{
+  std::swap(buffer_, rhs.buffer_);
+  std::swap(capacity_, rhs.capacity_);
+  std::swap(readerIndex_, rhs.readerIndex_);
+  std::swap(writerIndex_, rhs.writerIndex_);
+}
+
+void Buffer::shrink(size_t reserve)
+{
+  size_t capacity = readableBytes() + reserve > 0 ? BufferPool::roundUp(kCheapPrepend + readableBytes() + reserve) : 0;
+  if (capacity < capacity_)
+  {
+    reallocate(capacity);
+  }
+}
+
+void Buffer::detachPool()
+{
+  if (readableBytes() == 0)
+  {
+    reallocate(0);
+  }
+  pool_ = nullptr;
+}
+
+void Buffer::makeSpace(size_t len)
+{
+  if (writableBytes() + prependableBytes() // 空开了readableBytes
+      < len + kCheapPrepend)
+  {
+    // 扩容后writable长度至少为len，容量至少翻倍，避免频繁的重新分配
+    reallocate(std::max(capacity_ * 2, kCheapPrepend + readableBytes() + len));
+  }
+  else
+  {
+    // 读过的readable bytes + writable bytes够用
+    size_t readable = readableBytes();
+    // 把未读的数据部分复制到kCheapPrepend后面，剩余的所有空间给write做缓冲区
+    std::copy(begin() + readerIndex_, begin() + writerIndex_, begin() + kCheapPrepend);
+    readerIndex_ = kCheapPrepend;
+    writerIndex_ = readerIndex_ + readable;
+  }
+}
+
+void Buffer::reallocate(size_t capacity)
+{
+  size_t readable = readableBytes();
+  char *buffer = nullptr;
+  if (capacity > 0)
+  {
+    capacity = BufferPool::roundUp(capacity);
+    buffer = allocateStorage(pool_, capacity);
+    if (readable > 0)
+    {
+      ::memcpy(buffer + kCheapPrepend, peek(), readable);
+    }
+  }
+  if (buffer_)
+  {
+    freeStorage(pool_, buffer_, capacity_);
+  }
+  buffer_ = buffer;
+  capacity_ = capacity;
+  readerIndex_ = kCheapPrepend;
+  writerIndex_ = readerIndex_ + readable;
+}
+
+// 每个线程一块64k的溢出区，readv放不下的数据先读到这里再append到buffer_
+// 只在readFd内部使用且不清零，读多少数据就只会访问多少内存
+static __thread char t_extrabuf[Buffer::kExtraBufSize];
 
 ssize_t Buffer::readFd(int fd, int *saveErrno)
 {
   // read multi buffers
-  char extrabuf[65535] = {0}; // 64k栈空间，出作用域自动释放，是放之前已经被copy到buffer_
-
   struct iovec vec[2];
   const size_t writable = writableBytes();
-  vec[0].iov_base = begin() + writerIndex_;
-  vec[0].iov_len = writable;
-
-  vec[1].iov_base = extrabuf;
-  vec[1].iov_len = sizeof(extrabuf);
-
-  const int iovcnt = (writable < sizeof(extrabuf)) ? 2 : 1;
+  int iovcnt = 0;
+  if (writable > 0) // 还没有分配存储的Buffer直接读到t_extrabuf
+  {
+    vec[iovcnt].iov_base = begin() + writerIndex_;
+    vec[iovcnt].iov_len = writable;
+    ++iovcnt;
+  }
+  if (writable < sizeof(t_extrabuf))
+  {
+    vec[iovcnt].iov_base = t_extrabuf;
+    vec[iovcnt].iov_len = sizeof(t_extrabuf);
+    ++iovcnt;
+  }
 
   const ssize_t n = ::readv(fd, vec, iovcnt);
   if (n < 0)
@@ -28,8 +175,8 @@ ssize_t Buffer::readFd(int fd, int *saveErrno)
   }
   else
   {
-    writerIndex_ = buffer_.size();
-    append(extrabuf, n - writable);
+    writerIndex_ += writable;
+    append(t_extrabuf, n - writable);
   }
   return n;
 }
@@ -1,6 +1,6 @@
 #pragma once
 #include "copyable.h"
-#include <vector>
+#include "BufferPool.h"
 #include <string>
 #include <algorithm>
 
@@ -22,13 +22,23 @@ public:
   static const size_t kCheapPrepend = 8;
   static const size_t kInitialSize = 1024;
 
-  explicit Buffer(size_t initialSize = kInitialSize)
-      : buffer_(kCheapPrepend + initialSize), readerIndex_(kCheapPrepend), writerIndex_(kCheapPrepend)
-  {
-  }
+  explicit Buffer(size_t initialSize = kInitialSize) : Buffer(nullptr, initialSize) {}
+  // 存储空间从pool中分配，pool一般是连接所属EventLoop的bufferPool()
+  // initialSize为0时不分配任何存储空间，第一次写入时再分配
+  explicit Buffer(BufferPool *pool, size_t initialSize = kInitialSize);
+  Buffer(const Buffer &rhs);
+  Buffer(Buffer &&rhs) noexcept;
+  Buffer &operator=(Buffer rhs);
+  ~Buffer();
+
+  // 只交换存储和读写位置，不交换pool
+  // 所有存储都是按级别大小malloc出来的，在不同pool之间转移是安全的
+  void swap(Buffer &rhs);
+
   size_t prependableBytes() const { return readerIndex_; }
   size_t readableBytes() const { return writerIndex_ - readerIndex_; }
-  size_t writableBytes() const { return buffer_.size() - writerIndex_; }
+  size_t writableBytes() const { return capacity_ > writerIndex_ ? capacity_ - writerIndex_ : 0; }
+  size_t internalCapacity() const { return capacity_; }
 
   const char *peek() const
   {
@@ -92,37 +102,34 @@ public:
     return begin() + writerIndex_;
   }
 
+  // 只保留可读数据 + reserve大小的空间，多余的容量还给pool
+  void shrink(size_t reserve);
+  // 与pool解除关联：没有数据时直接把存储还给pool，否则之后的释放走free
+  // 之后Buffer析构时不再访问pool，可以在任意线程调用，不在pool所属线程时存储直接free
+  // 从pool分配的Buffer被move到其他线程或者可能比所属loop活得更久时，需要先调用
+  void detachPool();
+
+  static const size_t kExtraBufSize = 65536; // readFd使用的线程局部溢出区大小
   ssize_t readFd(int fd, int *saveErrno);
+  // 一次readFd最多读的字节数，读到的比这个少说明内核缓冲区已经读空
+  size_t readFdCapacity() const { return writableBytes() + (writableBytes() < kExtraBufSize ? kExtraBufSize : 0); }
 
 private:
   char *begin()
   {
-    return &*buffer_.begin();
+    return buffer_;
   }
   const char *begin() const
   {
-    return &*buffer_.begin();
+    return buffer_;
   }
 
-  void makeSpace(size_t len)
-  {
-    if (writableBytes() + prependableBytes() // 空开了readableBytes
-        < len + kCheapPrepend)
-    {
-      buffer_.resize(writerIndex_ + len); // 扩容writable长度到len
-    }
-    else
-    {
-      // 读过的readable bytes + writable bytes够用
-      size_t readable = readableBytes();
-      // 把未读的数据部分复制到kCheapPrepend后面，剩余的所有空间给write做缓冲区
-      std::copy(begin() + readerIndex_, begin() + writerIndex_, begin() + kCheapPrepend);
-      readerIndex_ = kCheapPrepend;
-      writerIndex_ = readerIndex_ + readable;
-    }
-  }
+  void makeSpace(size_t len);
+  void reallocate(size_t capacity); // 重新分配capacity大小的存储，可读数据移动到kCheapPrepend处
 
-  std::vector<char> buffer_; // 使用vector的动态扩容
+  BufferPool *pool_;
+  char *buffer_; // 从pool_分配，扩容时按级别大小翻倍
+  size_t capacity_;
   size_t readerIndex_;
   size_t writerIndex_;
 };
\ No newline at end of file
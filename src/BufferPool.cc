@@ -0,0 +1,96 @@
+#include "BufferPool.h"
+#include "CurrentThread.h"
+
+#include <stdlib.h>
+
+BufferPool::BufferPool() : threadId_(CurrentThread::tid()), cachedBytes_(0)
+{
+  for (int i = 0; i < kNumClasses; ++i)
+  {
+    freeLists_[i] = nullptr;
+    numCached_[i] = 0;
+  }
+}
+
+BufferPool::~BufferPool()
+{
+  for (int i = 0; i < kNumClasses; ++i)
+  {
+    while (freeLists_[i])
+    {
+      FreeBlock *next = freeLists_[i]->next;
+      ::free(freeLists_[i]);
+      freeLists_[i] = next;
+    }
+  }
+}
+
+char *BufferPool::allocate(size_t size)
+{
+  size = roundUp(size);
+  int idx = sizeClass(size);
+  if (idx >= 0 && isInOwnerThread() && freeLists_[idx])
+  {
+    FreeBlock *block = freeLists_[idx];
+    freeLists_[idx] = block->next;
+    --numCached_[idx];
+    cachedBytes_ -= size;
+    return reinterpret_cast<char *>(block);
+  }
+
+  char *block = static_cast<char *>(::malloc(size));
+  if (block == nullptr)
+  {
+    abort();
+  }
+  return block;
+}
+
+void BufferPool::deallocate(char *block, size_t size)
+{
+  size = roundUp(size);
+  int idx = sizeClass(size);
+  // 先判断线程，其他线程不读空闲链表的状态
+  if (idx >= 0 && isInOwnerThread() && numCached_[idx] * size < kMaxCachedBytesPerClass &&
+      cachedBytes_ + size <= kMaxCachedBytes)
+  {
+    FreeBlock *free = reinterpret_cast<FreeBlock *>(block);
+    free->next = freeLists_[idx];
+    freeLists_[idx] = free;
+    ++numCached_[idx];
+    cachedBytes_ += size;
+    return;
+  }
+  ::free(block);
+}
+
+size_t BufferPool::roundUp(size_t size)
+{
+  size_t classSize = kMinClassSize;
+  for (int i = 0; i < kNumClasses; ++i, classSize <<= 1)
+  {
+    if (size <= classSize)
+    {
+      return classSize;
+    }
+  }
+  return (size + 4095) & ~static_cast<size_t>(4095);
+}
+
+int BufferPool::sizeClass(size_t size)
+{
+  size_t classSize = kMinClassSize;
+  for (int i = 0; i < kNumClasses; ++i, classSize <<= 1)
+  {
+    if (size == classSize)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool BufferPool::isInOwnerThread() const
+{
+  return threadId_ == CurrentThread::tid();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "nocopyable.h"
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// 每个EventLoop持有一个BufferPool，为Buffer提供按大小分级（1K、2K、4K ... 4M）的内存块
+// 只有所属loop线程访问空闲链表，所以不需要加锁；其他线程分配/释放时直接走malloc/free
+// 所有的块都是按级别大小malloc出来的，所以池内的块可以在任意线程被free，池外的块也可以放回池中
+class BufferPool : nocopyable
+{
+public:
+  static const size_t kMinClassSize = 1024;
+  static const int kNumClasses = 13;                      // 1K << 12 = 4M
+  static const size_t kMaxCachedBytesPerClass = 8 << 20; // 每一级最多缓存的字节数
+  static const size_t kMaxCachedBytes = 16 << 20;        // 所有级别合计最多缓存的字节数，超出的块直接free
+
+  BufferPool();
+  ~BufferPool();
+
+  // 返回的块大小为roundUp(size)
+  char *allocate(size_t size);
+  void deallocate(char *block, size_t size);
+
+  // 向上取整到级别大小，超过最大级别的按4K对齐
+  static size_t roundUp(size_t size);
+
+  size_t cachedBytes() const { return cachedBytes_; }
+
+private:
+  struct FreeBlock
+  {
+    FreeBlock *next;
+  };
+
+  static int sizeClass(size_t size); // 不属于任何级别返回-1
+  bool isInOwnerThread() const;
+
+  const pid_t threadId_; // 创建BufferPool的线程，即所属EventLoop的线程
+  FreeBlock *freeLists_[kNumClasses];
+  size_t numCached_[kNumClasses];
+  size_t cachedBytes_;
+};
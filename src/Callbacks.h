@@ -2,18 +2,24 @@
 
 #include <memory>
 #include <functional>
+#include <string>
+
+#include "InlineFunction.h"
 
 class Buffer;
 class TcpConnection;
 class Timestamp;
 
 using TcpConnectionPtr = std::shared_ptr<TcpConnection>;
+using SharedBlock = std::shared_ptr<const std::string>; // 引用计数的只读数据块，多个连接发送同一份数据时不用拷贝
 using ConnectionCallback = std::function<void(const TcpConnectionPtr &)>;
 using CloseCallback = std::function<void(const TcpConnectionPtr &)>;
 using WriteCompleteCallback = std::function<void(const TcpConnectionPtr &)>;
 using MessageCallback = std::function<void(const TcpConnectionPtr &, Buffer *, Timestamp)>;
 using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr &, size_t)>;
-using TimerCallbck = std::function<void()>;
+using LowWaterMarkCallback = std::function<void(const TcpConnectionPtr &, size_t)>;
+// 连接相关的回调要从TcpServer拷贝给每个连接，仍然使用std::function
+using TimerCallbck = InlineFunction<void()>;
 
 void defaultConnectionCallback(const TcpConnectionPtr &conn);
 void defaultMessageCallback(const TcpConnectionPtr &conn,
@@ -0,0 +1,170 @@
+#include "ChainBuffer.h"
+
+#include <sys/uio.h>
+#include <limits.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+
+ChainBuffer::ChainBuffer()
+    : head_(nullptr), tail_(nullptr), freeList_(nullptr), numBlocks_(0), numFreeBlocks_(0), readable_(0)
+{
+}
+
+ChainBuffer::~ChainBuffer()
+{
+  retrieveAll();
+  shrink();
+}
+
+void ChainBuffer::append(const char *data, size_t len)
+{
+  readable_ += len;
+  while (len > 0)
+  {
+    if (tail_ == nullptr || tail_->writerIndex == tail_->capacity)
+    {
+      // 新block是上一个的2倍，最小能放下剩余的数据，不超过kBlockSize
+      size_t capacity = tail_ ? tail_->capacity * 2 : kMinBlockSize;
+      if (capacity > kBlockSize)
+      {
+        capacity = kBlockSize;
+      }
+      while (capacity < len && capacity < kBlockSize)
+      {
+        capacity <<= 1;
+      }
+      Block *block = allocBlock(capacity);
+      if (tail_)
+      {
+        tail_->next = block;
+      }
+      else
+      {
+        head_ = block;
+      }
+      tail_ = block;
+      ++numBlocks_;
+    }
+    size_t n = std::min(len, tail_->capacity - tail_->writerIndex);
+    ::memcpy(tail_->data() + tail_->writerIndex, data, n);
+    tail_->writerIndex += n;
+    data += n;
+    len -= n;
+  }
+}
+
+void ChainBuffer::retrieve(size_t len)
+{
+  if (len >= readable_)
+  {
+    retrieveAll();
+    return;
+  }
+
+  readable_ -= len;
+  while (len > 0)
+  {
+    size_t n = std::min(len, head_->writerIndex - head_->readerIndex);
+    head_->readerIndex += n;
+    len -= n;
+    // 只有被完全发送的block才会被摘下来，tail_上还能继续追加的block保留
+    if (head_->readerIndex == head_->writerIndex && head_ != tail_)
+    {
+      Block *block = head_;
+      head_ = head_->next;
+      --numBlocks_;
+      freeBlock(block);
+    }
+  }
+}
+
+void ChainBuffer::retrieveAll()
+{
+  while (head_)
+  {
+    Block *block = head_;
+    head_ = head_->next;
+    freeBlock(block);
+  }
+  tail_ = nullptr;
+  numBlocks_ = 0;
+  readable_ = 0;
+}
+
+void ChainBuffer::shrink()
+{
+  while (freeList_)
+  {
+    Block *next = freeList_->next;
+    ::free(freeList_);
+    freeList_ = next;
+  }
+  numFreeBlocks_ = 0;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int *saveErrno, size_t maxBytes)
+{
+  struct iovec vec[IOV_MAX];
+  int iovcnt = 0;
+  for (Block *block = head_; block && iovcnt < IOV_MAX && maxBytes > 0; block = block->next)
+  {
+    if (block->writerIndex > block->readerIndex)
+    {
+      size_t len = std::min(block->writerIndex - block->readerIndex, maxBytes);
+      vec[iovcnt].iov_base = block->data() + block->readerIndex;
+      vec[iovcnt].iov_len = len;
+      maxBytes -= len;
+      ++iovcnt;
+    }
+  }
+
+  const ssize_t n = ::writev(fd, vec, iovcnt);
+  if (n < 0)
+  {
+    *saveErrno = errno;
+  }
+  else
+  {
+    retrieve(n);
+  }
+  return n;
+}
+
+ChainBuffer::Block *ChainBuffer::allocBlock(size_t capacity)
+{
+  Block *block = freeList_;
+  if (block && block->capacity >= capacity)
+  {
+    freeList_ = block->next;
+    --numFreeBlocks_;
+  }
+  else
+  {
+    block = static_cast<Block *>(::malloc(sizeof(Block) + capacity));
+    if (block == nullptr)
+    {
+      abort();
+    }
+    block->capacity = capacity;
+  }
+  block->next = nullptr;
+  block->readerIndex = 0;
+  block->writerIndex = 0;
+  return block;
+}
+
+void ChainBuffer::freeBlock(Block *block)
+{
+  if (numFreeBlocks_ < kMaxFreeBlocks)
+  {
+    block->next = freeList_;
+    freeList_ = block;
+    ++numFreeBlocks_;
+  }
+  else
+  {
+    ::free(block);
+  }
+}
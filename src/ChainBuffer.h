@@ -0,0 +1,64 @@
+#pragma once
+
+#include "nocopyable.h"
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// 分段的发送缓冲区，由block组成的单链表
+// 与Buffer不同，数据一旦追加进来就不会再被移动（不会resize/copy已排队的数据），
+// 适合慢速读端 + 高水位很大的场景，写出时通过一次writev把多个block发出去
+// block从kMinBlockSize开始按2倍增长到kBlockSize，少量数据不会占用整个最大的block
+//
+// @code
+//  head_                                  tail_
+//   |                                       |
+// +-----------+     +-----------+     +-----------+
+// | r ... w   | --> | r ..... w | --> | r .. w    |
+// +-----------+     +-----------+     +-----------+
+// @endcode
+class ChainBuffer : nocopyable
+{
+public:
+  static const size_t kMinBlockSize = 4 * 1024;
+  static const size_t kBlockSize = 64 * 1024; // block的最大大小
+  static const size_t kMaxFreeBlocks = 1;     // 空闲链表最多缓存的block个数，多余的直接释放
+
+  ChainBuffer();
+  ~ChainBuffer();
+
+  size_t readableBytes() const { return readable_; }
+  size_t numBlocks() const { return numBlocks_; }
+  size_t numFreeBlocks() const { return numFreeBlocks_; }
+
+  void append(const char *data, size_t len);
+  void retrieve(size_t len);
+  void retrieveAll();
+  // 释放空闲链表中缓存的block
+  void shrink();
+
+  // 以writev的方式把可读数据写入fd，一次最多IOV_MAX个block、maxBytes字节，写出的数据会被retrieve
+  ssize_t writeFd(int fd, int *saveErrno, size_t maxBytes = static_cast<size_t>(-1));
+
+private:
+  // 数据紧跟在Block之后，共capacity字节
+  struct Block
+  {
+    char *data() { return reinterpret_cast<char *>(this + 1); }
+
+    Block *next;
+    size_t capacity;
+    size_t readerIndex;
+    size_t writerIndex;
+  };
+
+  Block *allocBlock(size_t capacity);
+  void freeBlock(Block *block); // 发送完的block放回空闲链表
+
+  Block *head_;
+  Block *tail_;
+  Block *freeList_;
+  size_t numBlocks_;
+  size_t numFreeBlocks_;
+  size_t readable_;
+};
@@ -2,6 +2,7 @@
 
 #include "nocopyable.h"
 #include "Timestamp.h"
+#include "InlineFunction.h"
 
 #include <functional>
 #include <memory>
@@ -11,8 +12,8 @@ class EventLoop;
 class Channel : nocopyable
 {
 public:
-  using EventCallback = std::function<void()>;
-  using ReadEventCallback = std::function<void(Timestamp)>;
+  using EventCallback = InlineFunction<void()>;
+  using ReadEventCallback = InlineFunction<void(Timestamp)>;
   Channel(EventLoop *loop, int fd);
   ~Channel();
 
@@ -26,7 +27,9 @@ public:
 
   void tie(const std::shared_ptr<void> &); // 管理channel的生命周期，防止执行回调操作的过程中，channel被delete掉
   int fd() const { return fd_; }
-  int events() const { return events_; }
+  // 边缘触发时注册到poller的事件带上kEdgeTriggered
+  int events() const { return events_ == kNoneEvent || !edgeTriggered_ ? events_ : events_ | kEdgeTriggered; }
+  int revents() const { return revents_; }
   void set_revents(int revt) { revents_ = revt; }
 
   // 设置events位，muduo同时支持epoll与poll
@@ -66,27 +69,57 @@ public:
   bool isWriting() { return events_ & kWriteEvent; }
   bool isReading() { return events_ & kReadEvent; }
 
+  // 边缘触发模式，需要回调一直读写到EAGAIN
+  void setEdgeTriggered(bool on)
+  {
+    edgeTriggered_ = on;
+    if (!isNoneEvent())
+    {
+      update();
+    }
+  }
+  bool edgeTriggered() const { return edgeTriggered_; }
+
+  // 在loop的就绪列表中等待处理的事件，见EventLoop::addReadyChannel
+  int readyEvents() const { return readyEvents_; }
+  void set_readyEvents(int events) { readyEvents_ = events; }
+
+  // EPollPoller延迟提交事件修改时使用：内核中已经注册的事件，以及是否在等待提交的列表中
+  int registeredEvents() const { return registeredEvents_; }
+  void set_registeredEvents(int events) { registeredEvents_ = events; }
+  bool updatePending() const { return updatePending_; }
+  void set_updatePending(bool pending) { updatePending_ = pending; }
+
   int index() { return index_; }
   void set_index(int idx) { index_ = idx; } // 更新channel在poller中的状态（new added deleted）
 
   EventLoop *ownerLoop() { return loop_; } // one loop per thread
+  // 拥有该channel的对象的名字（如连接名），指向的字符串与channel的生命周期相同，看门狗报告卡顿时使用
+  void setOwnerName(const char *name) { ownerName_ = name; }
+  const char *ownerName() const { return ownerName_; }
   void remove();
 
+  static const int kNoneEvent;
+  static const int kReadEvent;
+  static const int kWriteEvent;
+  static const int kEdgeTriggered;
+
 private:
   void update();
   void handleEventWithGuard(Timestamp receiveTime);
 
 private:
-  static const int kNoneEvent;
-  static const int kReadEvent;
-  static const int kWriteEvent;
-
   EventLoop *loop_;
   const int fd_; // channel对象的fd
   int events_;   // 注册的事件
   int revents_;  // poller 返回的事件
   int index_;    // 当前channel在poller中的状态（new Added Deleted）
+  bool edgeTriggered_;
+  int readyEvents_;
+  int registeredEvents_;
+  bool updatePending_;
   bool logHup_;
+  const char *ownerName_;
 
   std::weak_ptr<void> tie_;
   bool tied_;
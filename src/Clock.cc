@@ -0,0 +1,95 @@
+#include "Clock.h"
+#include "Logger.h"
+
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+int64_t MonotonicClock::nowNanos() noexcept
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+MonotonicClock::time_point MonotonicClock::fromTimestamp(Timestamp when)
+{
+  int64_t delta = when.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch();
+  return now() + std::chrono::microseconds(delta);
+}
+
+bool FastClock::enabled_ = false;
+bool FastClock::calibrated_ = false;
+uint64_t FastClock::tscBase_ = 0;
+uint64_t FastClock::nsPerTickQ32_ = 0;
+int64_t FastClock::monotonicBase_ = 0;
+int64_t FastClock::realtimeBase_ = 0;
+
+namespace
+{
+  int64_t realtimeNanos()
+  {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+  }
+}
+
+bool FastClock::setEnabled(bool on)
+{
+  if (on && !calibrated_ && !calibrate())
+  {
+    LOG_INFO("FastClock: invariant TSC not available, using clock_gettime")
+    return false;
+  }
+  enabled_ = on;
+  return true;
+}
+
+#if defined(__x86_64__)
+bool FastClock::calibrate()
+{
+  unsigned eax, ebx, ecx, edx;
+  // CPUID.80000007H:EDX[8]，TSC频率恒定且在所有核上同步
+  if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8)))
+  {
+    return false;
+  }
+  uint64_t tsc0 = __rdtsc();
+  int64_t mono0 = MonotonicClock::nowNanos();
+  int64_t real0 = realtimeNanos();
+  ::usleep(10 * 1000);
+  uint64_t tsc1 = __rdtsc();
+  int64_t mono1 = MonotonicClock::nowNanos();
+  if (tsc1 <= tsc0 || mono1 <= mono0)
+  {
+    return false;
+  }
+  tscBase_ = tsc0;
+  monotonicBase_ = mono0;
+  realtimeBase_ = real0;
+  nsPerTickQ32_ = (static_cast<unsigned __int128>(mono1 - mono0) << 32) / (tsc1 - tsc0);
+  calibrated_ = true;
+  LOG_INFO("FastClock calibrated: %.3f ticks per ns", static_cast<double>(tsc1 - tsc0) / (mono1 - mono0))
+  return true;
+}
+
+int64_t FastClock::fromTsc(int64_t base)
+{
+  uint64_t ticks = __rdtsc() - tscBase_;
+  return base + static_cast<int64_t>((static_cast<unsigned __int128>(ticks) * nsPerTickQ32_) >> 32);
+}
+#else
+bool FastClock::calibrate()
+{
+  return false;
+}
+
+int64_t FastClock::fromTsc(int64_t base)
+{
+  return base;
+}
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Timestamp.h"
+
+#include <chrono>
+#include <stdint.h>
+
+// CLOCK_MONOTONIC的纳秒时钟，满足std::chrono的Clock要求
+// 与timerfd使用同一个时钟，不受墙上时间调整的影响，定时器的到期时间都用它表示
+struct MonotonicClock
+{
+  using rep = int64_t;
+  using period = std::nano;
+  using duration = std::chrono::nanoseconds;
+  using time_point = std::chrono::time_point<MonotonicClock>;
+  static constexpr bool is_steady = true;
+
+  static time_point now() noexcept { return time_point(duration(nowNanos())); }
+  static int64_t nowNanos() noexcept;
+
+  // 把墙上时间换算为单调时钟的时间点，用于兼容以Timestamp表示的到期时间
+  static time_point fromTimestamp(Timestamp when);
+};
+
+// 基于TSC的快速时钟，用于poll返回时间、统计和跟踪等热路径上的时间戳
+// 启动时对照CLOCK_MONOTONIC和CLOCK_REALTIME校准，读一次只要一条rdtsc，不走vDSO
+// 只在有invariant TSC的x86-64上可用，不可用或者没有开启时退回clock_gettime/gettimeofday
+// 不跟随NTP对墙上时间的调整，不用于定时器
+class FastClock
+{
+public:
+  // 在启动各个EventLoop之前调用，第一次开启时校准（约10ms），不支持时返回false并保持关闭
+  static bool setEnabled(bool on);
+  static bool enabled() { return enabled_; }
+
+  // 单调时钟的纳秒数
+  static int64_t monotonicNanos()
+  {
+    return enabled_ ? fromTsc(monotonicBase_) : MonotonicClock::nowNanos();
+  }
+  // 墙上时间
+  static Timestamp timestamp()
+  {
+    return enabled_ ? Timestamp(fromTsc(realtimeBase_) / 1000) : Timestamp::now();
+  }
+
+private:
+  static bool calibrate();
+  static int64_t fromTsc(int64_t base);
+
+  static bool enabled_;
+  static bool calibrated_;
+  static uint64_t tscBase_;
+  static uint64_t nsPerTickQ32_; // 每个tick的纳秒数，32位定点小数
+  static int64_t monotonicBase_;
+  static int64_t realtimeBase_;
+};
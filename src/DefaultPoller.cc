@@ -1,5 +1,7 @@
 #include "Poller.h"
 #include "EPollPoller.h"
+#include "IoUringPoller.h"
+#include "Logger.h"
 #include <stdlib.h>
 Poller *Poller::newDefaultPoller(EventLoop *loop)
 {
@@ -7,8 +9,14 @@ Poller *Poller::newDefaultPoller(EventLoop *loop)
   {
     return nullptr; // 暂不支持poll
   }
-  else
+  else if (::getenv("MUDUO_USE_IOURING"))
   {
-    return new EPollPoller(loop);
+    Poller *poller = IoUringPoller::create(loop);
+    if (poller)
+    {
+      return poller;
+    }
+    LOG_INFO("io_uring is not supported, fall back to epoll")
   }
+  return new EPollPoller(loop);
 }
\ No newline at end of file
@@ -1,9 +1,11 @@
 #include "EPollPoller.h"
 #include "Logger.h"
 #include "Channel.h"
+#include "Clock.h"
 #include <unistd.h>
 #include <errno.h>
 #include <strings.h>
+#include <algorithm>
 
 // channel在poller中的状态，
 const int kNew = -1;    // channel未添加到poller中
@@ -28,9 +30,14 @@ EPollPoller::~EPollPoller()
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 {
   LOG_DEBUG("func=%s -> fd total count: %lu\n", __FUNCTION__, channels_.size())
+  if (!dirtyChannels_.empty())
+  {
+    applyUpdates();
+  }
+  ++syscalls_;
   int numEvents = ::epoll_wait(epollfd_, &*events_.begin(), static_cast<int>(events_.size()), timeoutMs);
   int saveErrno = errno;
-  Timestamp now(Timestamp::now());
+  Timestamp now(FastClock::timestamp());
 
   if (numEvents > 0)
   {
@@ -56,47 +63,71 @@ Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels)
   return now;
 }
 
+// 只记录channel的事件有修改，在下一次epoll_wait之前统一提交
+// 同一轮中开了又关的事件（例如写完数据后取消关注写事件）不用调用epoll_ctl，边缘触发的channel除外
 void EPollPoller::updateChannel(Channel *channel)
 {
   const int index = channel->index();
   LOG_INFO("func=%s -> fd=%d -> events=%d -> index=%d", __FUNCTION__, channel->fd(), channel->events(), index)
-  // 是新的channel或者是之前删除过的channel
-  if (index == kNew || index == kDeleted)
+  if (index == kNew)
   {
-    if (index == kNew)
-    {
-      int fd = channel->fd();
-      channels_[fd] = channel;
-    }
-
-    update(EPOLL_CTL_ADD, channel);
-    channel->set_index(kAdded);
+    channels_[channel->fd()] = channel;
   }
-  else
+  if (!channel->updatePending())
+  {
+    channel->set_updatePending(true);
+    dirtyChannels_.push_back(channel);
+  }
+  ++updatesAvoided_; // 立即提交时每次修改都是一次epoll_ctl，实际提交时再减掉
+}
+
+void EPollPoller::applyUpdates()
+{
+  for (Channel *channel : dirtyChannels_)
   {
-    // channel已经在poller上注册过了
-    int fd = channel->fd();
-    // 没有要关注的事件，删除掉channel
-    if (channel->isNoneEvent())
+    channel->set_updatePending(false);
+    const int events = channel->events();
+    if (channel->index() == kAdded)
     {
-      update(EPOLL_CTL_DEL, channel);
-      channel->set_index(kDeleted);
+      if (events == 0)
+      {
+        // 没有要关注的事件，从epoll中删除
+        update(EPOLL_CTL_DEL, channel);
+        channel->set_index(kDeleted);
+      }
+      else if (events != channel->registeredEvents() || channel->edgeTriggered())
+      {
+        // 边缘触发的channel即使关了又开回原样也要MOD：关注期间错过的边缘只有MOD能重新触发，
+        // 例如同一轮内pauseRead后又resumeRead，socket中剩余的数据不会再有新的边缘
+        update(EPOLL_CTL_MOD, channel);
+      }
     }
-    else
+    else if (events != 0)
     {
-      // 修改channel关注的事件
-      update(EPOLL_CTL_MOD, channel);
+      // 是新的channel或者是之前删除过的channel
+      update(EPOLL_CTL_ADD, channel);
+      channel->set_index(kAdded);
     }
   }
+  dirtyChannels_.clear();
 }
 
 void EPollPoller::removeChannel(Channel *channel)
 {
   int fd = channel->fd();
-  channels_.erase(fd);
+  bool updated = channels_.erase(fd) > 0;
   LOG_INFO("func=%s -> fd=%d", __FUNCTION__, fd)
-  int index = channel->index();
-  if (index == kAdded)
+  if (channel->updatePending())
+  {
+    channel->set_updatePending(false);
+    dirtyChannels_.erase(std::find(dirtyChannels_.begin(), dirtyChannels_.end(), channel));
+  }
+  if (updated && !channel->isNoneEvent())
+  {
+    ++updatesAvoided_; // 立即提交时这里还有一次EPOLL_CTL_DEL
+  }
+  // channel析构后fd会被关闭和复用，必须立即从epoll中删除
+  if (channel->index() == kAdded)
   {
     update(EPOLL_CTL_DEL, channel);
   }
@@ -123,6 +154,9 @@ void EPollPoller::update(int operation, Channel *channel)
   event.data.fd = fd;
   event.data.ptr = channel;
 
+  ++syscalls_;
+  --updatesAvoided_;
+  channel->set_registeredEvents(operation == EPOLL_CTL_DEL ? 0 : event.events);
   if (::epoll_ctl(epollfd_, operation, fd, &event) < 0)
   {
     if (operation == EPOLL_CTL_DEL)
@@ -21,9 +21,12 @@ private:
 
   // poller设置channel，即epoll_ctl设置fd
   void update(int operation, Channel *channel);
+  // 在epoll_wait之前统一提交本轮积累的事件修改
+  void applyUpdates();
 
   using EventList = std::vector<epoll_event>;
 
   int epollfd_;      // 该poller的fd
   EventList events_; // epoll_wait返回的events
+  ChannelList dirtyChannels_; // 事件有修改、还没提交给内核的channel
 };
\ No newline at end of file
@@ -4,8 +4,13 @@
 #include "Channel.h"
 #include "CurrentThread.h"
 #include "TimerQueue.h"
+#include "BufferPool.h"
+#include "TimingWheel.h"
+#include "LoopStats.h"
+#include "Tracer.h"
 #include <sys/eventfd.h>
 #include <memory>
+#include <algorithm>
 
 __thread EventLoop *t_loopInThisThread = nullptr; // 一个线程只能创建一个eventloop
 
@@ -27,10 +32,35 @@ EventLoop::EventLoop()
       quit_(false),
       callingPendingFunctors_(false),
       threadId_(CurrentThread::tid()),         // 获取当前EventLoop的tid
+      threadHandle_(pthread_self()),
+      busySinceNs_(0),
+      currentFd_(-1),
+      currentChannel_(nullptr),
+      currentFunctor_(nullptr),
       poller_(Poller::newDefaultPoller(this)), // 将该eventloop与poller绑定
+      bufferPool_(new BufferPool()),
+      bufferShrinkIdleSeconds_(0),
       wakeupFd_(createEventfd()),              // 通过eventfd实现唤醒subreactor处理channel，还可以socketpair来做
       wakeupChannel_(new Channel(this, wakeupFd_)),
-      timerQueue_(new TimerQueue(this))
+      polling_(false),
+      wakeupPending_(false),
+      wakeupsRequested_(0),
+      wakeupsIssued_(0),
+      busyPollUs_(0),
+      socketBusyPollUs_(0),
+      spinPolls_(0),
+      lastActiveNs_(0),
+      edgeTriggeredBudget_(256 * 1024),
+      eventHandling_(false),
+      writeCoalescing_(false),
+      coalescedSends_(0),
+      coalescedFlushes_(0),
+      memoryBudget_(0),
+      bufferedBytes_(0),
+      stats_(new LoopStats()),
+      timerQueue_(new TimerQueue(this)),
+      timerSlack_(0),
+      timingWheelTickMs_(TimingWheel::kDefaultTickMs)
 {
   LOG_DEBUG("EventLoop created %p in thread %d", this, threadId_)
   if (t_loopInThisThread)
@@ -65,18 +95,75 @@ void EventLoop::loop()
 
   LOG_INFO("EventLoop %p start looping", this)
 
+  int64_t pollEnd = 0;
   while (!quit_)
   {
     activeChannels_.clear();
+    int timeoutMs = kPollTimeMs;
+    // 用单调时钟判断，墙上时间回拨不会让loop一直空转
+    if (!readyChannels_.empty() || (busyPollUs_ > 0 && pollEnd - lastActiveNs_ < busyPollUs_ * 1000LL))
+    {
+      // 低延迟模式下最近有过活动，不阻塞，以0超时继续轮询
+      timeoutMs = 0;
+      ++spinPolls_;
+    }
+    else
+    {
+      // 先声明即将阻塞再检查队列，与wakeup()中先入队再检查polling_配对，
+      // 保证要么这里看到新的回调不阻塞，要么wakeup()看到polling_写eventfd
+      polling_.store(true);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!pendingFunctors_.empty() || quit_)
+      {
+        timeoutMs = 0;
+      }
+      else
+      {
+        timeoutMs = timerQueue_->pollTimeoutMs(timeoutMs);
+      }
+    }
+    busySinceNs_.store(0, std::memory_order_relaxed);
+    int64_t pollStart = LoopStats::nowNanos();
     // 交给poller将epoll_wait的channel返回到activeChannels_
-    pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+    pollReturnTime_ = poller_->poll(timeoutMs, &activeChannels_);
+    polling_.store(false, std::memory_order_relaxed);
+    pollEnd = LoopStats::nowNanos();
+    busySinceNs_.store(pollEnd, std::memory_order_relaxed);
+    if (Tracer::enabled())
+    {
+      Tracer::record("poll", pollStart, pollEnd, activeChannels_.size());
+    }
+    if (!activeChannels_.empty())
+    {
+      lastActiveNs_ = pollEnd;
+    }
+    if (!readyChannels_.empty())
+    {
+      mergeReadyChannels();
+    }
+    eventHandling_ = true;
     for (Channel *channel : activeChannels_)
     {
+      currentChannel_.store(channel, std::memory_order_relaxed);
+      currentFd_.store(channel->fd(), std::memory_order_relaxed);
       // 在poller中已经将channel的_revents修改，直接调用channel处理事件
+      TraceSpan span("handleEvent", channel->fd());
       channel->handleEvent(pollReturnTime());
     }
+    currentChannel_.store(nullptr, std::memory_order_relaxed);
+    currentFd_.store(-1, std::memory_order_relaxed);
+    timerQueue_->expireTimers();
+    eventHandling_ = false;
+    doWriteFlushes();
+    size_t events = activeChannels_.size();
+    int64_t callbackEnd = LoopStats::nowNanos();
 
-    doPendingFunctors();
+    size_t functors = doPendingFunctors();
+    if (functors > 0)
+    {
+      lastActiveNs_ = pollEnd;
+    }
+    stats_->recordIteration(pollEnd - pollStart, callbackEnd - pollEnd, LoopStats::nowNanos() - callbackEnd, events, functors);
   }
 
   LOG_INFO("EventLoop %p stop looping", this)
@@ -100,16 +187,13 @@ void EventLoop::runInLoop(Functor cb)
   }
   else
   {
-    queueInLoop(cb);
+    queueInLoop(std::move(cb));
   }
 }
 
 void EventLoop::queueInLoop(Functor cb)
 {
-  {
-    std::unique_lock<std::mutex> lock(mutex_);
-    pendingFunctors_.emplace_back(cb);
-  }
+  pendingFunctors_.push(std::move(cb));
 
   if (!isInLoopThread() || callingPendingFunctors_)
   {
@@ -119,6 +203,14 @@ void EventLoop::queueInLoop(Functor cb)
 
 void EventLoop::wakeup()
 {
+  wakeupsRequested_.fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  // loop没有阻塞时会在下次poll之前看到新的回调；已经有未处理的唤醒时不用再写
+  if (!polling_.load() || wakeupPending_.exchange(true))
+  {
+    return;
+  }
+  wakeupsIssued_.fetch_add(1, std::memory_order_relaxed);
   uint64_t one = 1;
   ssize_t n = write(wakeupFd_, &one, sizeof(one));
   if (n != sizeof(one))
@@ -135,6 +227,11 @@ void EventLoop::updateChannel(Channel *channel)
 
 void EventLoop::removeChannel(Channel *channel)
 {
+  if (channel->readyEvents())
+  {
+    channel->set_readyEvents(0);
+    readyChannels_.erase(std::find(readyChannels_.begin(), readyChannels_.end(), channel));
+  }
   // channel通过EventLoop调用Poller将channel的fd从epoll删除
   poller_->removeChannel(channel);
 }
@@ -144,40 +241,173 @@ bool EventLoop::hasChannel(Channel *channel)
   return poller_->hasChannel(channel);
 }
 
-TimerId EventLoop::runAt(Timestamp time, TimerCallbck cb)
+int64_t EventLoop::pollerSyscalls() const
+{
+  return poller_->syscalls();
+}
+
+int64_t EventLoop::pollerUpdatesAvoided() const
+{
+  return poller_->updatesAvoided();
+}
+
+TimerId EventLoop::runAt(Timestamp time, TimerCallbck cb, int slackUs)
+{
+  return runAt(MonotonicClock::fromTimestamp(time), std::move(cb), std::chrono::microseconds(slackUs));
+}
+
+TimerId EventLoop::runAfter(int delay, TimerCallbck cb, int slackUs)
+{
+  return runAfter(std::chrono::seconds(delay), std::move(cb), std::chrono::microseconds(slackUs));
+}
+
+TimerId EventLoop::runEvery(int interval, TimerCallbck cb, int slackUs)
+{
+  return runEvery(std::chrono::seconds(interval), std::move(cb), std::chrono::microseconds(slackUs));
+}
+
+TimerId EventLoop::runAt(MonotonicClock::time_point time, TimerCallbck cb, TimerDuration slack)
+{
+  return timerQueue_->addTimer(std::move(cb), time, TimerDuration::zero(), slack.count() < 0 ? timerSlack_ : slack);
+}
+
+TimerId EventLoop::runAfter(TimerDuration delay, TimerCallbck cb, TimerDuration slack)
+{
+  return runAt(MonotonicClock::now() + delay, std::move(cb), slack);
+}
+
+TimerId EventLoop::runEvery(TimerDuration interval, TimerCallbck cb, TimerDuration slack)
+{
+  return timerQueue_->addTimer(std::move(cb), MonotonicClock::now() + interval, interval, slack.count() < 0 ? timerSlack_ : slack);
+}
+
+void EventLoop::setTimerPollTimeout(bool on)
+{
+  runInLoop([this, on]()
+            { timerQueue_->setUsePollTimeout(on); });
+}
+
+int64_t EventLoop::timerArms() const
 {
-  return timerQueue_->addTimer(std::move(cb), time, 0);
+  return timerQueue_->arms();
 }
 
-TimerId EventLoop::runAfter(int delay, TimerCallbck cb)
+void EventLoop::cancel(TimerId timerId)
 {
-  Timestamp time(addTime(Timestamp::now(), delay));
-  return runAt(time, std::move(cb));
+  timerQueue_->cancel(timerId);
+}
+
+TimingWheel *EventLoop::timingWheel()
+{
+  if (!timingWheel_)
+  {
+    timingWheel_.reset(new TimingWheel(this, timingWheelTickMs_));
+  }
+  return timingWheel_.get();
 }
 
 void EventLoop::handleRead()
 {
   uint64_t one = 1;
   ssize_t n = read(wakeupFd_, &one, sizeof(one));
+  wakeupPending_.store(false);
   if (n != sizeof(one))
   {
     LOG_ERROR("EventLoop::handleRead() reads %lu bytes instead of 8", n)
   }
 }
 
-void EventLoop::doPendingFunctors()
+void EventLoop::addReadyChannel(Channel *channel, int events)
 {
-  std::vector<Functor> functors; // 函数对象数组
-  callingPendingFunctors_ = true;
+  if (!channel->readyEvents())
   {
-    std::unique_lock<std::mutex> lock(mutex_);
-    functors.swap(pendingFunctors_);
+    readyChannels_.push_back(channel);
   }
+  channel->set_readyEvents(channel->readyEvents() | events);
+}
 
-  for (const Functor &functor : functors)
+// 把上一轮就绪列表中的channel并入activeChannels_，同时被poller返回的channel合并事件
+// 只保留channel当前仍然关注的事件，入队之后被暂停读、取消写或者关闭的channel不再重放
+void EventLoop::mergeReadyChannels()
+{
+  for (Channel *channel : activeChannels_)
+  {
+    if (channel->readyEvents())
+    {
+      channel->set_revents(channel->revents() | (channel->readyEvents() & channel->events()));
+      channel->set_readyEvents(0);
+    }
+  }
+  for (Channel *channel : readyChannels_)
   {
-    functor(); // 当前loop需要执行的callback
+    int events = channel->readyEvents() & channel->events();
+    channel->set_readyEvents(0);
+    if (events)
+    {
+      channel->set_revents(events);
+      activeChannels_.push_back(channel);
+    }
   }
+  readyChannels_.clear();
+}
 
+void EventLoop::queueWriteFlush(Functor flush)
+{
+  writeFlushes_.emplace_back(std::move(flush));
+}
+
+void EventLoop::doWriteFlushes()
+{
+  if (writeFlushes_.empty())
+  {
+    return;
+  }
+
+  std::vector<Functor> flushes;
+  flushes.swap(writeFlushes_);
+  coalescedFlushes_ += flushes.size();
+  for (const Functor &flush : flushes)
+  {
+    flush();
+  }
+}
+
+void EventLoop::setMemoryBudget(size_t budget)
+{
+  memoryBudget_ = budget;
+  adjustBufferedBytes(0);
+}
+
+void EventLoop::adjustBufferedBytes(ssize_t delta)
+{
+  bufferedBytes_ += delta;
+  if (!budgetResumes_.empty() && (memoryBudget_ == 0 || bufferedBytes_ <= memoryBudget_ / 2))
+  {
+    std::vector<Functor> resumes;
+    resumes.swap(budgetResumes_);
+    for (Functor &resume : resumes)
+    {
+      queueInLoop(std::move(resume));
+    }
+  }
+}
+
+void EventLoop::queueBudgetResume(Functor resume)
+{
+  budgetResumes_.emplace_back(std::move(resume));
+}
+
+size_t EventLoop::doPendingFunctors()
+{
+  callingPendingFunctors_ = true;
+  // 只执行开始时已经入队的回调，执行期间新投递的留到下一轮
+  size_t count = pendingFunctors_.consume([this](Functor &functor)
+                                          {
+                                            currentFunctor_.store(functor.codeAddress(), std::memory_order_relaxed);
+                                            TraceSpan span("functor");
+                                            functor(); // 当前loop需要执行的callback
+                                          });
+  currentFunctor_.store(nullptr, std::memory_order_relaxed);
   callingPendingFunctors_ = false;
+  return count;
 }
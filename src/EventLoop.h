@@ -3,24 +3,30 @@
 #include <functional>
 #include <atomic>
 #include <vector>
-#include <mutex>
 #include <memory>
+#include <pthread.h>
 
 #include "nocopyable.h"
 #include "Timestamp.h"
+#include "Clock.h"
 #include "CurrentThread.h"
 #include "TimerId.h"
 #include "Callbacks.h"
+#include "MpscQueue.h"
+#include "InlineFunction.h"
 
 class Channel;
 class Poller;
 class TimerQueue;
+class BufferPool;
+class TimingWheel;
+class LoopStats;
 
 // Reactor
 class EventLoop : nocopyable
 {
 public:
-  using Functor = std::function<void()>;
+  using Functor = InlineFunction<void()>; // 只能移动，常见的闭包不分配内存
   EventLoop();
   ~EventLoop();
 
@@ -33,19 +39,106 @@ public:
   void runInLoop(Functor cb);
   void queueInLoop(Functor cb);
 
+  // 只有loop阻塞（或即将阻塞）在poll中、且还没有未处理的唤醒时才写eventfd
   void wakeup();
+  int64_t wakeupsRequested() const { return wakeupsRequested_.load(std::memory_order_relaxed); }
+  int64_t wakeupsIssued() const { return wakeupsIssued_.load(std::memory_order_relaxed); }
 
   void updateChannel(Channel *channel);
   void removeChannel(Channel *channel);
   bool hasChannel(Channel *channel);
+  // poller发起的系统调用次数，用于比较epoll和io_uring后端
+  int64_t pollerSyscalls() const;
+  // 延迟提交事件修改省下的epoll_ctl次数
+  int64_t pollerUpdatesAvoided() const;
 
   bool isInLoopThread() const { return threadId_ == CurrentThread::tid(); }
-  TimerId runAt(Timestamp time, TimerCallbck cb);
-  TimerId runAfter(int delay, TimerCallbck cb);
+  // 定时器的到期时间使用单调时钟，time为墙上时间时按当前的差值换算
+  // slackUs为定时器允许推迟执行的微秒数，-1表示使用setTimerSlack设置的默认值
+  TimerId runAt(Timestamp time, TimerCallbck cb, int slackUs = -1);
+  // delay、interval以秒为单位
+  TimerId runAfter(int delay, TimerCallbck cb, int slackUs = -1);
+  // 每interval秒执行一次，第一次在interval秒之后
+  TimerId runEvery(int interval, TimerCallbck cb, int slackUs = -1);
+  // std::chrono版本，精度为纳秒，如runAfter(std::chrono::microseconds(200), cb)，slack为负表示使用默认值
+  using TimerDuration = MonotonicClock::duration;
+  TimerId runAt(MonotonicClock::time_point time, TimerCallbck cb, TimerDuration slack = TimerDuration(-1));
+  TimerId runAfter(TimerDuration delay, TimerCallbck cb, TimerDuration slack = TimerDuration(-1));
+  TimerId runEvery(TimerDuration interval, TimerCallbck cb, TimerDuration slack = TimerDuration(-1));
+  // 可以在任意线程调用，在loop线程中调用时立即生效，也可以在定时器自己的回调中取消重复定时器
+  void cancel(TimerId timerId);
+  // 本loop上定时器默认的slack，到期时间相近的定时器合并触发，减少timerfd_settime，需在添加定时器之前设置
+  void setTimerSlack(int microseconds) { timerSlack_ = std::chrono::microseconds(microseconds); }
+  // 开启后不使用timerfd，把最早的触发时间折算进poll的超时（精度为毫秒），省去timerfd的设置和读
+  void setTimerPollTimeout(bool on);
+  int64_t timerArms() const; // timerfd_settime的调用次数
+
+  // 本loop上连接的Buffer存储从该pool分配，只能在loop线程中使用
+  BufferPool *bufferPool() const { return bufferPool_.get(); }
+  // 连接的Buffer被读空后空闲超过seconds秒，把多余的容量还给pool，0表示不收缩
+  void setBufferShrinkIdleSeconds(int seconds) { bufferShrinkIdleSeconds_ = seconds; }
+  int bufferShrinkIdleSeconds() const { return bufferShrinkIdleSeconds_; }
+
+  // 写合并：开启后，处理activeChannels_期间连接上的send只暂存到发送缓冲区，
+  // 处理完所有activeChannels_后每个连接只写一次，减少write系统调用和小TCP段
+  void setWriteCoalescing(bool on) { writeCoalescing_ = on; }
+  bool coalescingWrites() const { return writeCoalescing_ && eventHandling_; }
+  // 由TcpConnection调用，flush在本次迭代处理完activeChannels_之后执行
+  void queueWriteFlush(Functor flush);
+  void countCoalescedSend() { ++coalescedSends_; }
+  int64_t coalescedSends() const { return coalescedSends_; }
+  int64_t coalescedFlushes() const { return coalescedFlushes_; }
+  int64_t writeSyscallsSaved() const { return coalescedSends_ - coalescedFlushes_; }
+
+  // 本loop上所有连接缓冲区（输入+输出）的总字节数超过budget时，读数据的连接会暂停读，
+  // 降到budget的一半以下时恢复，0表示不限制
+  void setMemoryBudget(size_t budget);
+  size_t memoryBudget() const { return memoryBudget_; }
+  size_t bufferedBytes() const { return bufferedBytes_; }
+  bool overMemoryBudget() const { return memoryBudget_ > 0 && bufferedBytes_ > memoryBudget_; }
+  // 由TcpConnection在loop线程中调用
+  void adjustBufferedBytes(ssize_t delta);
+  void queueBudgetResume(Functor resume);
+
+  // 低延迟模式：有过事件或回调之后的microseconds微秒内以0超时轮询，不阻塞在poll中，
+  // 超过这段时间没有活动则退回阻塞，0表示关闭
+  void setBusyPoll(int microseconds) { busyPollUs_ = microseconds; }
+  int busyPoll() const { return busyPollUs_; }
+  int64_t spinPolls() const { return spinPolls_; }
+  // 对本loop上新建立的连接设置SO_BUSY_POLL，由内核在读socket时忙等网卡队列，0表示不设置
+  void setSocketBusyPoll(int microseconds) { socketBusyPollUs_ = microseconds; }
+  int socketBusyPoll() const { return socketBusyPollUs_; }
+
+  // 边缘触发的连接每轮最多读/写budget字节，用完预算后还有数据的channel放进就绪列表，
+  // 下一轮不等poller通知直接处理，避免一个连接饿死同一个loop上的其他连接
+  void setEdgeTriggeredBudget(size_t bytes) { edgeTriggeredBudget_ = bytes; }
+  size_t edgeTriggeredBudget() const { return edgeTriggeredBudget_; }
+  void addReadyChannel(Channel *channel, int events);
+
+  // 每轮迭代的耗时、事件数、回调个数和定时器延迟，只在loop线程中写入，快照可以在任意线程读取
+  LoopStats *stats() const { return stats_.get(); }
+
+  // 看门狗读取的当前进度，只由loop线程写入，见LoopWatchdog
+  pthread_t threadHandle() const { return threadHandle_; }
+  // 本轮处理开始（poll返回）的LoopStats::nowNanos()，阻塞在poll中时为0
+  int64_t busySinceNs() const { return busySinceNs_.load(std::memory_order_relaxed); }
+  // 正在处理事件的channel的fd，没有时为-1
+  int currentFd() const { return currentFd_.load(std::memory_order_relaxed); }
+  // 正在处理事件的channel，只能在loop线程中（如信号处理函数里）解引用
+  Channel *currentChannel() const { return currentChannel_.load(std::memory_order_relaxed); }
+  // 正在执行的投递回调的代码地址，见InlineFunction::codeAddress
+  const void *currentFunctor() const { return currentFunctor_.load(std::memory_order_relaxed); }
+
+  // 本loop的时间轮，用于大量连接的空闲超时，第一次使用时创建，只能在loop线程中使用
+  TimingWheel *timingWheel();
+  // 时间轮的tick精度，需在第一次使用timingWheel()之前设置
+  void setTimingWheelTick(int tickMs) { timingWheelTickMs_ = tickMs; }
 
 private:
   void handleRead();
-  void doPendingFunctors();
+  size_t doPendingFunctors(); // 返回执行的回调个数
+  void doWriteFlushes();
+  void mergeReadyChannels();
 
 private:
   using ChannelList = std::vector<Channel *>;
@@ -54,17 +147,46 @@ private:
   std::atomic_bool quit_;
 
   const pid_t threadId_; // 创建当前EventLoop的thread
-
-  std::mutex mutex_; // TODO:分析muduo Mutex类实现
+  const pthread_t threadHandle_;
+  std::atomic<int64_t> busySinceNs_;
+  std::atomic<int> currentFd_;
+  std::atomic<Channel *> currentChannel_;
+  std::atomic<const void *> currentFunctor_;
 
   Timestamp pollReturnTime_;
   std::unique_ptr<Poller> poller_;
+  std::unique_ptr<BufferPool> bufferPool_; // 需要在pendingFunctors_之后析构，其中可能持有连接
+  int bufferShrinkIdleSeconds_;
 
   int wakeupFd_;
   std::unique_ptr<Channel> wakeupChannel_;
+  std::atomic_bool polling_;       // loop准备进入或正阻塞在poll中
+  std::atomic_bool wakeupPending_; // 已经写了eventfd，loop还没读
+  std::atomic<int64_t> wakeupsRequested_;
+  std::atomic<int64_t> wakeupsIssued_;
   ChannelList activeChannels_; // poller返回的有就绪事件的channel
+  int busyPollUs_;
+  int socketBusyPollUs_;
+  int64_t spinPolls_;
+  int64_t lastActiveNs_; // 最近一次有事件或回调的时间，LoopStats::nowNanos()
+  ChannelList readyChannels_;  // 边缘触发下用完预算、下一轮继续处理的channel
+  size_t edgeTriggeredBudget_;
+
+  bool eventHandling_; // 正在处理activeChannels_
+  bool writeCoalescing_;
+  std::vector<Functor> writeFlushes_;
+  int64_t coalescedSends_;
+  int64_t coalescedFlushes_;
+
+  size_t memoryBudget_;
+  size_t bufferedBytes_;
+  std::vector<Functor> budgetResumes_; // 因内存预算暂停读的连接
 
   std::atomic_bool callingPendingFunctors_;
-  std::vector<Functor> pendingFunctors_;
+  MpscQueue<Functor> pendingFunctors_; // 其他线程投递的回调，无锁入队，由loop线程消费
+  std::unique_ptr<LoopStats> stats_;
   std::unique_ptr<TimerQueue> timerQueue_;
+  TimerDuration timerSlack_;
+  int timingWheelTickMs_;
+  std::unique_ptr<TimingWheel> timingWheel_;
 };
\ No newline at end of file
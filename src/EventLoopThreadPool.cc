@@ -1,5 +1,6 @@
 #include "EventLoopThreadPool.h"
 #include "EventLoopThread.h"
+#include "EventLoop.h"
 
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg)
     : baseLoop_(baseLoop), name_(nameArg), started_(false), numThreads_(0), next_(0)
@@ -56,3 +57,15 @@ std::vector<EventLoop *> EventLoopThreadPool::getAllLoops()
     return std::vector<EventLoop *>(1, baseLoop_);
   }
 }
+
+LoopStatsSnapshot EventLoopThreadPool::statsSnapshot()
+{
+  LoopStatsSnapshot total;
+  LoopStatsSnapshot one;
+  for (EventLoop *loop : getAllLoops())
+  {
+    loop->stats()->snapshot(&one);
+    total.merge(one);
+  }
+  return total;
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "nocopyable.h"
+#include "LoopStats.h"
 
 #include <functional>
 #include <string>
@@ -22,6 +23,8 @@ public:
 
   EventLoop *getNextLoop();
   std::vector<EventLoop *> getAllLoops();
+  // 汇总所有loop的统计，可以在任意线程调用
+  LoopStatsSnapshot statsSnapshot();
 
   bool started() const { return started_; }
   const std::string name() const { return name_; }
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 只能移动的函数对象包装，代替std::function用于投递到loop的回调、定时器回调和Channel的回调
+// 不超过Capacity字节、可以noexcept移动的可调用对象直接存放在内部，不分配内存
+// 例如std::bind(&TcpConnection::xxx, shared_from_this(), ...)，libstdc++的std::function只能内联16字节，这种闭包都要分配内存
+// 更大的对象退化为堆上分配
+template <typename Signature, size_t Capacity = 64>
+class InlineFunction;
+
+template <typename R, typename... Args, size_t Capacity>
+class InlineFunction<R(Args...), Capacity>
+{
+public:
+  static const size_t kCapacity = Capacity;
+
+  InlineFunction() noexcept : ops_(nullptr) {}
+  InlineFunction(std::nullptr_t) noexcept : ops_(nullptr) {}
+
+  template <typename F,
+            typename Fn = typename std::decay<F>::type,
+            typename = typename std::enable_if<!std::is_same<Fn, InlineFunction>::value &&
+                                               std::is_invocable_r<R, Fn &, Args...>::value>::type>
+  InlineFunction(F &&f) : ops_(nullptr)
+  {
+    if (isNull<Fn>(f))
+    {
+      return;
+    }
+    if constexpr (kFitsInline<Fn>)
+    {
+      new (storage_) Fn(std::forward<F>(f));
+      ops_ = &InlineOps<Fn>::kOps;
+    }
+    else
+    {
+      *reinterpret_cast<Fn **>(storage_) = new Fn(std::forward<F>(f));
+      ops_ = &HeapOps<Fn>::kOps;
+    }
+  }
+
+  InlineFunction(InlineFunction &&other) noexcept : ops_(other.ops_)
+  {
+    if (ops_)
+    {
+      ops_->move(storage_, other.storage_);
+      other.ops_ = nullptr;
+    }
+  }
+
+  InlineFunction &operator=(InlineFunction &&other) noexcept
+  {
+    if (this != &other)
+    {
+      reset();
+      if (other.ops_)
+      {
+        other.ops_->move(storage_, other.storage_);
+        ops_ = other.ops_;
+        other.ops_ = nullptr;
+      }
+    }
+    return *this;
+  }
+
+  InlineFunction &operator=(std::nullptr_t) noexcept
+  {
+    reset();
+    return *this;
+  }
+
+  InlineFunction(const InlineFunction &) = delete;
+  InlineFunction &operator=(const InlineFunction &) = delete;
+
+  ~InlineFunction() { reset(); }
+
+  explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+  R operator()(Args... args) const
+  {
+    if (!ops_)
+    {
+      throw std::bad_function_call();
+    }
+    return ops_->invoke(const_cast<unsigned char *>(storage_), std::forward<Args>(args)...);
+  }
+
+  // 可调用对象是否直接存放在内部
+  bool isInline() const noexcept { return ops_ && ops_->isInline; }
+  // 调用入口的代码地址，每种可调用对象类型各不相同，用于诊断时符号化出闭包的类型
+  const void *codeAddress() const noexcept { return ops_ ? reinterpret_cast<const void *>(ops_->invoke) : nullptr; }
+
+private:
+  struct Ops
+  {
+    R (*invoke)(void *storage, Args &&...args);
+    void (*move)(void *dst, void *src) noexcept; // 移动到dst并析构src
+    void (*destroy)(void *storage) noexcept;
+    bool isInline;
+  };
+
+  template <typename Fn>
+  static constexpr bool kFitsInline = sizeof(Fn) <= Capacity &&
+                                      alignof(Fn) <= alignof(std::max_align_t) &&
+                                      std::is_nothrow_move_constructible<Fn>::value;
+
+  // 与std::function一致：支持成员函数指针，R为void时丢弃返回值
+  template <typename Fn>
+  static R call(Fn &fn, Args &&...args)
+  {
+    if constexpr (std::is_void<R>::value)
+    {
+      std::invoke(fn, std::forward<Args>(args)...);
+    }
+    else
+    {
+      return std::invoke(fn, std::forward<Args>(args)...);
+    }
+  }
+
+  template <typename Fn>
+  struct InlineOps
+  {
+    static R invoke(void *storage, Args &&...args)
+    {
+      return call(*static_cast<Fn *>(storage), std::forward<Args>(args)...);
+    }
+    static void move(void *dst, void *src) noexcept
+    {
+      new (dst) Fn(std::move(*static_cast<Fn *>(src)));
+      static_cast<Fn *>(src)->~Fn();
+    }
+    static void destroy(void *storage) noexcept { static_cast<Fn *>(storage)->~Fn(); }
+    static constexpr Ops kOps = {&invoke, &move, &destroy, true};
+  };
+
+  template <typename Fn>
+  struct HeapOps
+  {
+    static R invoke(void *storage, Args &&...args)
+    {
+      return call(**static_cast<Fn **>(storage), std::forward<Args>(args)...);
+    }
+    static void move(void *dst, void *src) noexcept
+    {
+      *static_cast<Fn **>(dst) = *static_cast<Fn **>(src);
+    }
+    static void destroy(void *storage) noexcept { delete *static_cast<Fn **>(storage); }
+    static constexpr Ops kOps = {&invoke, &move, &destroy, false};
+  };
+
+  // 空的函数指针、std::function等转换为空的InlineFunction
+  template <typename F>
+  static bool isNull(const F &f)
+  {
+    if constexpr (std::is_pointer<F>::value || std::is_member_pointer<F>::value)
+    {
+      return f == nullptr;
+    }
+    else
+    {
+      return isNullFunction(&f);
+    }
+  }
+
+  template <typename Sig>
+  static bool isNullFunction(const std::function<Sig> *f) { return !*f; }
+  static bool isNullFunction(const void *) { return false; }
+
+  void reset() noexcept
+  {
+    if (ops_)
+    {
+      ops_->destroy(storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  alignas(std::max_align_t) unsigned char storage_[Capacity];
+  const Ops *ops_;
+};
@@ -0,0 +1,353 @@
+#include "IoUringPoller.h"
+#include "Logger.h"
+#include "Channel.h"
+#include "Clock.h"
+
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+
+// channel在poller中的状态，与EPollPoller相同
+const int kNew = -1;
+const int kAdded = 1;
+const int kDeleted = 2;
+
+const uint64_t kInternalToken = 0; // POLL_REMOVE等内部请求的完成事件
+
+namespace
+{
+  unsigned loadAcquire(const unsigned *p)
+  {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+  }
+
+  void storeRelease(unsigned *p, unsigned v)
+  {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+  }
+}
+
+IoUringPoller *IoUringPoller::create(EventLoop *loop)
+{
+  IoUringPoller *poller = new IoUringPoller(loop);
+  if (!poller->setup())
+  {
+    delete poller;
+    return nullptr;
+  }
+  return poller;
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop),
+      ringFd_(-1),
+      sqRing_(MAP_FAILED),
+      sqRingSize_(0),
+      cqRing_(MAP_FAILED),
+      cqRingSize_(0),
+      sqes_(static_cast<io_uring_sqe *>(MAP_FAILED)),
+      sqesSize_(0),
+      sqLocalTail_(0),
+      generation_(0),
+      batch_(0)
+{
+}
+
+IoUringPoller::~IoUringPoller()
+{
+  if (sqes_ != MAP_FAILED)
+  {
+    ::munmap(sqes_, sqesSize_);
+  }
+  if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_)
+  {
+    ::munmap(cqRing_, cqRingSize_);
+  }
+  if (sqRing_ != MAP_FAILED)
+  {
+    ::munmap(sqRing_, sqRingSize_);
+  }
+  if (ringFd_ >= 0)
+  {
+    ::close(ringFd_);
+  }
+}
+
+bool IoUringPoller::setup()
+{
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = kCqEntries;
+  ringFd_ = static_cast<int>(::syscall(__NR_io_uring_setup, kSqEntries, &params));
+  if (ringFd_ < 0)
+  {
+    LOG_INFO("io_uring_setup failed: %d", errno)
+    return false;
+  }
+  // 等待超时需要IORING_ENTER_EXT_ARG（5.11），multishot poll在5.13加入，用同期的RSRC_TAGS判断
+  const unsigned required = IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS;
+  if ((params.features & required) != required)
+  {
+    LOG_INFO("io_uring lacks required features: %x", params.features)
+    return false;
+  }
+
+  sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+  }
+  sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+  if (sqRing_ == MAP_FAILED)
+  {
+    return false;
+  }
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    cqRing_ = sqRing_;
+  }
+  else
+  {
+    cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+    if (cqRing_ == MAP_FAILED)
+    {
+      return false;
+    }
+  }
+  sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = static_cast<io_uring_sqe *>(::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES));
+  if (sqes_ == MAP_FAILED)
+  {
+    return false;
+  }
+
+  char *sq = static_cast<char *>(sqRing_);
+  sqHead_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+  sqTail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sqMask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sqArray_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  sqEntries_ = params.sq_entries;
+  sqLocalTail_ = *sqTail_;
+
+  char *cq = static_cast<char *>(cqRing_);
+  cqHead_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cqTail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cqMask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+  LOG_INFO("IoUringPoller created, sq=%u cq=%u", params.sq_entries, params.cq_entries)
+  return true;
+}
+
+int IoUringPoller::enter(unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argSize)
+{
+  ++syscalls_;
+  return static_cast<int>(::syscall(__NR_io_uring_enter, ringFd_, toSubmit, minComplete, flags, arg, argSize));
+}
+
+io_uring_sqe *IoUringPoller::getSqe()
+{
+  while (sqLocalTail_ - loadAcquire(sqHead_) >= sqEntries_)
+  {
+    // SQ满了，先把已经准备好的提交掉
+    if (enter(pendingSubmissions(), 0, 0, nullptr, 0) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+    {
+      LOG_FATAL("io_uring_enter submit error: %d", errno)
+      abort();
+    }
+  }
+  unsigned index = sqLocalTail_ & *sqMask_;
+  io_uring_sqe *sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqArray_[index] = index;
+  ++sqLocalTail_;
+  return sqe;
+}
+
+void IoUringPoller::arm(int fd, Registration &reg)
+{
+  int events = reg.channel->events();
+  io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = static_cast<uint32_t>(events & ~EPOLLET);
+  if (events & EPOLLET)
+  {
+    sqe->len = IORING_POLL_ADD_MULTI;
+  }
+  reg.token = (static_cast<uint64_t>(++generation_) << 32) | static_cast<uint32_t>(fd);
+  sqe->user_data = reg.token;
+  reg.armed = true;
+  storeRelease(sqTail_, sqLocalTail_);
+}
+
+void IoUringPoller::cancel(Registration &reg)
+{
+  if (!reg.armed)
+  {
+    return;
+  }
+  io_uring_sqe *sqe = getSqe();
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = reg.token;
+  sqe->user_data = kInternalToken;
+  reg.armed = false;
+  storeRelease(sqTail_, sqLocalTail_);
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+  LOG_DEBUG("func=%s -> fd total count: %lu\n", __FUNCTION__, channels_.size())
+  // 单次poll触发过的fd，处理完事件后重新提交
+  for (int fd : rearm_)
+  {
+    auto it = registrations_.find(fd);
+    if (it != registrations_.end() && it->second.rearmQueued)
+    {
+      it->second.rearmQueued = false;
+      if (!it->second.armed && !it->second.channel->isNoneEvent())
+      {
+        arm(fd, it->second);
+      }
+    }
+  }
+  rearm_.clear();
+
+  unsigned minComplete = 0;
+  __kernel_timespec ts;
+  io_uring_getevents_arg arg;
+  memset(&arg, 0, sizeof(arg));
+  if (loadAcquire(cqTail_) == *cqHead_ && timeoutMs != 0)
+  {
+    minComplete = 1;
+    if (timeoutMs > 0)
+    {
+      ts.tv_sec = timeoutMs / 1000;
+      ts.tv_nsec = (timeoutMs % 1000) * 1000 * 1000;
+      arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+  }
+
+  // 本轮所有的注册、修改、删除和等待事件合并为一次io_uring_enter
+  int ret = 0;
+  unsigned toSubmit = pendingSubmissions();
+  if (minComplete > 0 || toSubmit > 0)
+  {
+    ret = enter(toSubmit, minComplete, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+  }
+  int saveErrno = errno;
+  Timestamp now(FastClock::timestamp());
+  if (ret < 0 && saveErrno != ETIME && saveErrno != EINTR && saveErrno != EBUSY)
+  {
+    errno = saveErrno;
+    LOG_ERROR("IoUringPoller::poll() error!")
+  }
+
+  reapCompletions(activeChannels);
+  return now;
+}
+
+void IoUringPoller::reapCompletions(ChannelList *activeChannels)
+{
+  ++batch_;
+  unsigned head = *cqHead_;
+  unsigned tail = loadAcquire(cqTail_);
+  for (; head != tail; ++head)
+  {
+    const io_uring_cqe &cqe = cqes_[head & *cqMask_];
+    if (cqe.user_data == kInternalToken)
+    {
+      continue;
+    }
+    int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+    auto it = registrations_.find(fd);
+    if (it == registrations_.end() || it->second.token != cqe.user_data)
+    {
+      continue; // 已经取消或者重新提交过的请求
+    }
+    Registration &reg = it->second;
+    if (!(cqe.flags & IORING_CQE_F_MORE))
+    {
+      // 单次poll已经触发，或者multishot被内核终止，处理完事件后重新提交
+      reg.armed = false;
+      if (!reg.rearmQueued)
+      {
+        reg.rearmQueued = true;
+        rearm_.push_back(fd);
+      }
+    }
+    if (cqe.res == -ECANCELED)
+    {
+      continue;
+    }
+    int revents = cqe.res < 0 ? static_cast<int>(EPOLLERR) : cqe.res;
+    if (reg.batch == batch_)
+    {
+      // 同一轮中同一个fd的多个事件合并
+      reg.channel->set_revents(reg.channel->revents() | revents);
+    }
+    else
+    {
+      reg.batch = batch_;
+      reg.channel->set_revents(revents);
+      activeChannels->push_back(reg.channel);
+    }
+  }
+  storeRelease(cqHead_, head);
+  if (!activeChannels->empty())
+  {
+    LOG_INFO("%lu events happend", activeChannels->size())
+  }
+}
+
+void IoUringPoller::updateChannel(Channel *channel)
+{
+  const int index = channel->index();
+  int fd = channel->fd();
+  LOG_INFO("func=%s -> fd=%d -> events=%d -> index=%d", __FUNCTION__, fd, channel->events(), index)
+  if (index == kNew || index == kDeleted)
+  {
+    if (index == kNew)
+    {
+      channels_[fd] = channel;
+    }
+    Registration &reg = registrations_[fd];
+    reg = Registration{channel, 0, false, false, 0};
+    arm(fd, reg);
+    channel->set_index(kAdded);
+  }
+  else
+  {
+    Registration &reg = registrations_[fd];
+    cancel(reg);
+    if (channel->isNoneEvent())
+    {
+      channel->set_index(kDeleted);
+    }
+    else
+    {
+      arm(fd, reg);
+    }
+  }
+}
+
+void IoUringPoller::removeChannel(Channel *channel)
+{
+  int fd = channel->fd();
+  channels_.erase(fd);
+  LOG_INFO("func=%s -> fd=%d", __FUNCTION__, fd)
+  auto it = registrations_.find(fd);
+  if (it != registrations_.end())
+  {
+    cancel(it->second);
+    registrations_.erase(it);
+  }
+  channel->set_index(kNew);
+}
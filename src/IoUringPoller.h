@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Poller.h"
+
+#include <linux/io_uring.h>
+#include <stdint.h>
+
+// 基于io_uring的Poller，用IORING_OP_POLL_ADD监听channel的事件
+// 注册、修改、删除事件只是往SQ里放SQE，和等待事件一起在每轮poll的一次io_uring_enter中提交，
+// 连接很多时省去了epoll_ctl的系统调用
+// 水平触发的channel使用单次poll，事件处理完之后在下一轮重新提交，语义与epoll的LT一致；
+// 边缘触发（EPOLLET）的channel使用multishot poll，一次提交持续产生事件
+// 内核不支持时create返回nullptr，由newDefaultPoller退回epoll
+// 只替代了就绪通知，TcpConnection的读写仍然是普通的read/write系统调用，没有基于完成的读写和注册缓冲区
+class IoUringPoller : public Poller
+{
+public:
+  static IoUringPoller *create(EventLoop *loop);
+  ~IoUringPoller() override;
+
+  Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+  void updateChannel(Channel *channel) override;
+  void removeChannel(Channel *channel) override;
+
+private:
+  static const unsigned kSqEntries = 1024;
+  static const unsigned kCqEntries = 8192;
+
+  // 每个fd当前的poll请求，token编码了fd和代数，已经取消的请求的完成事件按token过滤掉
+  struct Registration
+  {
+    Channel *channel;
+    uint64_t token;
+    bool armed;       // 有一个在内核中等待的poll请求
+    bool rearmQueued; // 已经放进rearm_，在下一轮poll前重新提交
+    int64_t batch;    // 最近一次放进activeChannels的轮次，同一轮的多个完成事件合并
+  };
+
+  explicit IoUringPoller(EventLoop *loop);
+  bool setup();
+
+  io_uring_sqe *getSqe();
+  // 已经放进SQ、内核还没取走的SQE个数
+  unsigned pendingSubmissions() const { return sqLocalTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE); }
+  int enter(unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argSize);
+  void arm(int fd, Registration &reg);
+  void cancel(Registration &reg);
+  void reapCompletions(ChannelList *activeChannels);
+
+  int ringFd_;
+  void *sqRing_;
+  size_t sqRingSize_;
+  void *cqRing_;
+  size_t cqRingSize_;
+  io_uring_sqe *sqes_;
+  size_t sqesSize_;
+
+  unsigned *sqHead_;
+  unsigned *sqTail_;
+  unsigned *sqMask_;
+  unsigned *sqArray_;
+  unsigned sqEntries_;
+  unsigned sqLocalTail_;
+
+  unsigned *cqHead_;
+  unsigned *cqTail_;
+  unsigned *cqMask_;
+  io_uring_cqe *cqes_;
+
+  uint32_t generation_;
+  int64_t batch_;
+  std::unordered_map<int, Registration> registrations_;
+  std::vector<int> rearm_; // 单次poll已经触发、还需要继续监听的fd
+};
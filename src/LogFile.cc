@@ -0,0 +1,102 @@
+#include "LogFile.h"
+
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+
+LogFile::LogFile(const std::string &basename, off_t rollSize)
+    : basename_(basename),
+      rollSize_(rollSize),
+      fp_(nullptr),
+      writtenBytes_(0),
+      startOfPeriod_(0),
+      lastRoll_(0)
+{
+  rollFile();
+}
+
+LogFile::~LogFile()
+{
+  if (fp_)
+  {
+    flush();
+    ::fclose(fp_);
+  }
+}
+
+void LogFile::append(const char *data, size_t len)
+{
+  if (!fp_)
+  {
+    return;
+  }
+  size_t written = 0;
+  while (written < len)
+  {
+    size_t n = ::fwrite_unlocked(data + written, 1, len - written, fp_);
+    if (n == 0)
+    {
+      // 这里不能用LOG_ERROR，日志本身就写到这里
+      fprintf(stderr, "LogFile::append failed: %s\n", strerror(ferror(fp_) ? errno : EIO));
+      clearerr(fp_);
+      break;
+    }
+    written += n;
+  }
+  writtenBytes_ += written;
+
+  time_t now = ::time(nullptr);
+  if (writtenBytes_ > rollSize_ || now / kRollPerSeconds * kRollPerSeconds != startOfPeriod_)
+  {
+    rollFile();
+  }
+}
+
+void LogFile::flush()
+{
+  if (fp_)
+  {
+    ::fflush(fp_);
+    ::fdatasync(::fileno(fp_));
+  }
+}
+
+void LogFile::rollFile()
+{
+  time_t now = ::time(nullptr);
+  if (fp_ && now <= lastRoll_)
+  {
+    return;
+  }
+  std::string filename = logFileName(basename_, now);
+  FILE *fp = ::fopen(filename.c_str(), "ae");
+  if (!fp)
+  {
+    fprintf(stderr, "LogFile open %s failed: %s\n", filename.c_str(), strerror(errno));
+    return;
+  }
+  if (fp_)
+  {
+    flush();
+    ::fclose(fp_);
+  }
+  fp_ = fp;
+  ::setvbuf(fp_, buffer_, _IOFBF, sizeof(buffer_));
+  writtenBytes_ = 0;
+  lastRoll_ = now;
+  startOfPeriod_ = now / kRollPerSeconds * kRollPerSeconds;
+}
+
+std::string LogFile::logFileName(const std::string &basename, time_t now)
+{
+  char timebuf[32];
+  struct tm tm;
+  ::localtime_r(&now, &tm);
+  ::strftime(timebuf, sizeof(timebuf), ".%Y%m%d-%H%M%S.", &tm);
+  char hostname[256] = "unknownhost";
+  ::gethostname(hostname, sizeof(hostname) - 1);
+  char pidbuf[32];
+  snprintf(pidbuf, sizeof(pidbuf), ".%d.log", ::getpid());
+  return basename + timebuf + hostname + pidbuf;
+}
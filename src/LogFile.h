@@ -0,0 +1,35 @@
+#pragma once
+
+#include "nocopyable.h"
+
+#include <string>
+#include <stdio.h>
+#include <sys/types.h>
+
+// 滚动日志文件，只由AsyncLogging的后台线程使用，不加锁
+// 文件名为 basename.年月日-时分秒.主机名.pid.log，写满rollSize字节或者跨天时换一个新文件
+class LogFile : nocopyable
+{
+public:
+  LogFile(const std::string &basename, off_t rollSize);
+  ~LogFile();
+
+  void append(const char *data, size_t len);
+  // fflush之后fdatasync，把这一批写入落盘
+  void flush();
+  void rollFile();
+
+  off_t writtenBytes() const { return writtenBytes_; }
+
+private:
+  static std::string logFileName(const std::string &basename, time_t now);
+
+  const std::string basename_;
+  const off_t rollSize_;
+  FILE *fp_;
+  off_t writtenBytes_;
+  time_t startOfPeriod_; // 当前文件所在的那一天的0点（UTC）
+  time_t lastRoll_;      // 文件名精确到秒，同一秒内不重复滚动
+  char buffer_[64 * 1024]; // stdio缓冲区，多次append合并为一次write
+  static const int kRollPerSeconds = 60 * 60 * 24;
+};
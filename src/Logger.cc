@@ -1,7 +1,37 @@
 #include "Logger.h"
-#include "Timestamp.h"
 
-#include <iostream>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+std::atomic<int> Logger::logLevel_(MUDUO_MIN_LOG_LEVEL);
+
+namespace
+{
+  const char *const kLevelTags[] = {"[DEBUG]", "[INFO]", "[ERROR]", "[FATAL]"};
+
+  // 同一秒内的日志复用格式化好的时间，localtime_r每秒每个线程只调用一次
+  __thread time_t t_lastSecond = -1;
+  __thread char t_time[32];
+  __thread int t_timeLength = 0;
+
+  int formatTime(char *buf)
+  {
+    time_t now = ::time(nullptr);
+    if (now != t_lastSecond)
+    {
+      struct tm tm;
+      ::localtime_r(&now, &tm);
+      t_timeLength = snprintf(t_time, sizeof(t_time), "%4d/%02d/%02d %02d:%02d:%02d",
+                              tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+      t_lastSecond = now;
+    }
+    memcpy(buf, t_time, t_timeLength);
+    return t_timeLength;
+  }
+}
 
 Logger &Logger::instance()
 {
@@ -9,27 +39,39 @@ Logger &Logger::instance()
   return logger;
 }
 
-void Logger::setLogLevel(int level) { logLevel_ = level; }
+void Logger::setOutput(OutputFunc output) { output_ = std::move(output); }
 
-void Logger::log(std::string msg)
+void Logger::log(LogLevel level, const char *logmsgFormat, ...)
 {
-  switch (logLevel_)
+  // 不清零，所有写入的长度都是确定的
+  char buf[1024];
+  const size_t kMaxLength = sizeof(buf) - 1; // 留一个字节给换行
+  size_t len = strlen(kLevelTags[level]);
+  memcpy(buf, kLevelTags[level], len);
+  len += formatTime(buf + len);
+  memcpy(buf + len, " : ", 3);
+  len += 3;
+
+  va_list args;
+  va_start(args, logmsgFormat);
+  int n = vsnprintf(buf + len, sizeof(buf) - len, logmsgFormat, args);
+  va_end(args);
+  if (n > 0)
+  {
+    len = std::min(len + n, kMaxLength);
+  }
+  buf[len++] = '\n';
+
+  // 整行拼好之后一次输出，多个线程的日志不会交错
+  if (output_)
   {
-  case INFO:
-    std::cout << "[INFO]";
-    break;
-  case ERROR:
-    std::cout << "[ERROR]";
-    break;
-  case FATAL:
-    std::cout << "[FATAL]";
-    break;
-  case DEBUG:
-    std::cout << "[DEBUG]";
-    break;
-
-  default:
-    break;
+    output_(buf, static_cast<int>(len));
+    if (level == FATAL)
+    {
+      ::fwrite(buf, 1, len, stderr);
+    }
+    return;
   }
-  std::cout << Timestamp::now().toString() << " : " << msg << std::endl;
-}
\ No newline at end of file
+  ::fwrite(buf, 1, len, stdout);
+  ::fflush(stdout);
+}
@@ -1,73 +1,95 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include <string>
 
 #include "nocopyable.h"
 
-#define LOG_INFO(logmsgFormat, ...)                   \
-  do                                                  \
-  {                                                   \
-    Logger &logger = Logger::instance();              \
-    logger.setLogLevel(INFO);                         \
-    char buf[1024] = {0};                             \
-    snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-    logger.log(buf);                                  \
-  } while (0);
+// 编译期的最低日志级别，低于它的日志调用被编译器整个去掉，参数不会求值，但仍然做格式和类型检查
+// 取值与LogLevel一致：0 DEBUG，1 INFO，2 ERROR，3 FATAL；定义了MUDEBUG时默认保留DEBUG
+#ifndef MUDUO_MIN_LOG_LEVEL
+#ifdef MUDEBUG
+#define MUDUO_MIN_LOG_LEVEL 0
+#else
+#define MUDUO_MIN_LOG_LEVEL 1
+#endif
+#endif
 
-#define LOG_ERROR(logmsgFormat, ...)                  \
-  do                                                  \
-  {                                                   \
-    Logger &logger = Logger::instance();              \
-    logger.setLogLevel(ERROR);                        \
-    char buf[1024] = {0};                             \
-    snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-    logger.log(buf);                                  \
+// 先检查运行时级别再格式化，关闭时只有一次relaxed的原子读和分支
+#define MUDUO_LOG(level, logmsgFormat, ...)                       \
+  do                                                              \
+  {                                                               \
+    if (Logger::enabled(level))                                   \
+    {                                                             \
+      Logger::instance().log(level, logmsgFormat, ##__VA_ARGS__); \
+    }                                                             \
   } while (0);
 
-#define LOG_FATAL(logmsgFormat, ...)                  \
-  do                                                  \
-  {                                                   \
-    Logger &logger = Logger::instance();              \
-    logger.setLogLevel(FATAL);                        \
-    char buf[1024] = {0};                             \
-    snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-    logger.log(buf);                                  \
+// 编译期关闭的级别：if (false)保证参数仍被检查、变量算作被使用，不产生代码
+#define MUDUO_LOG_DISABLED(level, logmsgFormat, ...)              \
+  do                                                              \
+  {                                                               \
+    if (false)                                                    \
+    {                                                             \
+      Logger::instance().log(level, logmsgFormat, ##__VA_ARGS__); \
+    }                                                             \
   } while (0);
 
-#ifdef MUDEBUG
-#define LOG_DEBUG(logmsgFormat, ...)                \
-  do                                                \
-  {                                                 \
-    Logger &logger = Logger::instance();            \
-    logger.setLogLevel(DEBUG);                      \
-    char buf[1024] = {0};                           \
-    snprintf(buf, 1024, logmsgFormat, ##_VA_ARGS_); \
-    logger.log(buf);                                \
-  } while (0);
+#if MUDUO_MIN_LOG_LEVEL <= 0
+#define LOG_DEBUG(logmsgFormat, ...) MUDUO_LOG(DEBUG, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(logmsgFormat, ...) MUDUO_LOG_DISABLED(DEBUG, logmsgFormat, ##__VA_ARGS__)
+#endif
 
+#if MUDUO_MIN_LOG_LEVEL <= 1
+#define LOG_INFO(logmsgFormat, ...) MUDUO_LOG(INFO, logmsgFormat, ##__VA_ARGS__)
 #else
-#define LOG_DEBUG(logmsgFormat, ...)
+#define LOG_INFO(logmsgFormat, ...) MUDUO_LOG_DISABLED(INFO, logmsgFormat, ##__VA_ARGS__)
 #endif
 
+#if MUDUO_MIN_LOG_LEVEL <= 2
+#define LOG_ERROR(logmsgFormat, ...) MUDUO_LOG(ERROR, logmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(logmsgFormat, ...) MUDUO_LOG_DISABLED(ERROR, logmsgFormat, ##__VA_ARGS__)
+#endif
+
+// FATAL不受编译期和运行时级别影响，调用方随后会退出进程
+#define LOG_FATAL(logmsgFormat, ...) Logger::instance().log(FATAL, logmsgFormat, ##__VA_ARGS__);
+
 enum LogLevel
 {
+  DEBUG,
   INFO,
   ERROR,
-  FATAL,
-  DEBUG
+  FATAL
 };
 
 class Logger : nocopyable
 {
 public:
+  // 输出一整行日志（带换行），默认写到stdout
+  using OutputFunc = std::function<void(const char *msg, int len)>;
+
   // 单例模式的logger，线程安全
   static Logger &instance();
-  void setLogLevel(int level);
-  void log(std::string msg);
+
+  // 运行时的日志级别，低于它的日志不格式化也不输出，可以在任意线程调用
+  static LogLevel logLevel() { return static_cast<LogLevel>(logLevel_.load(std::memory_order_relaxed)); }
+  static void setLogLevel(LogLevel level) { logLevel_.store(level, std::memory_order_relaxed); }
+  static bool enabled(LogLevel level) { return level >= logLevel_.load(std::memory_order_relaxed); }
+
+  // 级别随每次调用传入，不经过共享状态；整行在栈上的缓冲区中拼好，超过1KB的部分截断
+  void log(LogLevel level, const char *logmsgFormat, ...) __attribute__((format(printf, 3, 4)));
+
+  // 替换日志的输出，例如接到AsyncLogging::append，需要在其他线程开始打日志之前设置
+  // 设置了自定义输出时FATAL日志还会同步写一份到stderr，保证进程退出前能看到
+  void setOutput(OutputFunc output);
 
 private:
   Logger() {}
 
 private:
-  int logLevel_;
-};
\ No newline at end of file
+  static std::atomic<int> logLevel_;
+  OutputFunc output_;
+};
@@ -0,0 +1,116 @@
+#include "LoopStats.h"
+#include "Clock.h"
+
+#include <stdio.h>
+
+void HistogramSnapshot::merge(const HistogramSnapshot &other)
+{
+  count += other.count;
+  sum += other.sum;
+  if (other.max > max)
+  {
+    max = other.max;
+  }
+  for (int i = 0; i < kBuckets; ++i)
+  {
+    buckets[i] += other.buckets[i];
+  }
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const
+{
+  if (count == 0)
+  {
+    return 0;
+  }
+  uint64_t rank = static_cast<uint64_t>(p / 100 * count);
+  if (rank >= count)
+  {
+    rank = count - 1;
+  }
+  uint64_t seen = 0;
+  for (int i = 0; i < kBuckets; ++i)
+  {
+    seen += buckets[i];
+    if (seen > rank)
+    {
+      return bucketValue(i);
+    }
+  }
+  return max;
+}
+
+Histogram::Histogram() : count_(0), sum_(0), max_(0)
+{
+  for (std::atomic<uint64_t> &bucket : buckets_)
+  {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+void Histogram::snapshot(HistogramSnapshot *out) const
+{
+  // 与写入并发时各字段之间可能差几次记录，统计上可以忽略
+  out->count = count_.load(std::memory_order_relaxed);
+  out->sum = sum_.load(std::memory_order_relaxed);
+  out->max = max_.load(std::memory_order_relaxed);
+  for (int i = 0; i < HistogramSnapshot::kBuckets; ++i)
+  {
+    out->buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+}
+
+void LoopStatsSnapshot::merge(const LoopStatsSnapshot &other)
+{
+  iterations += other.iterations;
+  pollNs.merge(other.pollNs);
+  callbackNs.merge(other.callbackNs);
+  functorNs.merge(other.functorNs);
+  events.merge(other.events);
+  queueDepth.merge(other.queueDepth);
+  timerLagUs.merge(other.timerLagUs);
+}
+
+std::string LoopStatsSnapshot::toString() const
+{
+  std::string result;
+  char buf[256];
+  snprintf(buf, sizeof(buf), "iterations=%lu\n", iterations);
+  result += buf;
+
+  struct Row
+  {
+    const char *name;
+    const HistogramSnapshot *histogram;
+  };
+  const Row rows[] = {{"poll ns", &pollNs},
+                      {"callback ns", &callbackNs},
+                      {"functor ns", &functorNs},
+                      {"events", &events},
+                      {"queue depth", &queueDepth},
+                      {"timer lag us", &timerLagUs}};
+  for (const Row &row : rows)
+  {
+    const HistogramSnapshot &h = *row.histogram;
+    snprintf(buf, sizeof(buf), "%-12s count=%lu mean=%.1f p50=%lu p99=%lu p999=%lu max=%lu\n",
+             row.name, h.count, h.mean(), h.percentile(50), h.percentile(99), h.percentile(99.9), h.max);
+    result += buf;
+  }
+  return result;
+}
+
+int64_t LoopStats::nowNanos()
+{
+  return FastClock::monotonicNanos();
+}
+
+void LoopStats::snapshot(LoopStatsSnapshot *out) const
+{
+  out->iterations = iterations_.load(std::memory_order_relaxed);
+  pollNs_.snapshot(&out->pollNs);
+  callbackNs_.snapshot(&out->callbackNs);
+  functorNs_.snapshot(&out->functorNs);
+  events_.snapshot(&out->events);
+  queueDepth_.snapshot(&out->queueDepth);
+  timerLagUs_.snapshot(&out->timerLagUs);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "nocopyable.h"
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+// 对数线性直方图：按最高位分组，每组再等分为kSubBuckets个桶，相对误差不超过1/kSubBuckets
+// 小于kSubBuckets的值各占一个桶，64位的值一共kBuckets个桶
+struct HistogramSnapshot
+{
+  static const int kSubBits = 3;
+  static const int kSubBuckets = 1 << kSubBits;
+  static const int kBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+  static int bucketOf(uint64_t value)
+  {
+    if (value < kSubBuckets)
+    {
+      return static_cast<int>(value);
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - kSubBits;
+    return (shift + 1) * kSubBuckets + static_cast<int>((value >> shift) & (kSubBuckets - 1));
+  }
+  // 桶的下界
+  static uint64_t bucketValue(int bucket)
+  {
+    if (bucket < kSubBuckets)
+    {
+      return bucket;
+    }
+    int shift = bucket / kSubBuckets - 1;
+    return static_cast<uint64_t>(kSubBuckets + bucket % kSubBuckets) << shift;
+  }
+
+  void merge(const HistogramSnapshot &other);
+  // p取[0, 100]，返回所在桶的下界
+  uint64_t percentile(double p) const;
+  double mean() const { return count > 0 ? static_cast<double>(sum) / count : 0; }
+
+  uint64_t count = 0;
+  uint64_t sum = 0;
+  uint64_t max = 0;
+  uint64_t buckets[kBuckets] = {0};
+};
+
+// 只由一个线程写入的直方图，其他线程可以随时读出快照
+// 写入只是relaxed的load+store，没有原子的读改写和锁
+class Histogram : nocopyable
+{
+public:
+  Histogram();
+
+  void record(uint64_t value)
+  {
+    bump(buckets_[HistogramSnapshot::bucketOf(value)], 1);
+    bump(count_, 1);
+    bump(sum_, value);
+    if (value > max_.load(std::memory_order_relaxed))
+    {
+      max_.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  void snapshot(HistogramSnapshot *out) const;
+
+private:
+  static void bump(std::atomic<uint64_t> &counter, uint64_t delta)
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> max_;
+  std::atomic<uint64_t> buckets_[HistogramSnapshot::kBuckets];
+};
+
+// 一个或多个EventLoop的统计快照
+struct LoopStatsSnapshot
+{
+  void merge(const LoopStatsSnapshot &other);
+  std::string toString() const;
+
+  uint64_t iterations = 0;
+  HistogramSnapshot pollNs;       // poll耗时，包含阻塞等待的时间
+  HistogramSnapshot callbackNs;   // 处理activeChannels_和合并写的耗时
+  HistogramSnapshot functorNs;    // doPendingFunctors的耗时
+  HistogramSnapshot events;       // 每轮的就绪channel个数
+  HistogramSnapshot queueDepth;   // 每轮执行的投递回调个数
+  HistogramSnapshot timerLagUs;   // 定时器实际执行时间减去到期时间
+};
+
+// 每个EventLoop一个，只由loop线程写入，按cache line对齐，不与其他loop的数据共享cache line
+class alignas(64) LoopStats : nocopyable
+{
+public:
+  LoopStats() : iterations_(0) {}
+
+  // 单调时钟的纳秒数，开启FastClock时读TSC，否则走vDSO，都不陷入内核
+  static int64_t nowNanos();
+
+  void recordIteration(int64_t pollNs, int64_t callbackNs, int64_t functorNs, size_t events, size_t functors)
+  {
+    iterations_.store(iterations_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    pollNs_.record(pollNs);
+    callbackNs_.record(callbackNs);
+    functorNs_.record(functorNs);
+    events_.record(events);
+    queueDepth_.record(functors);
+  }
+  void recordTimerLag(int64_t lagUs) { timerLagUs_.record(lagUs > 0 ? lagUs : 0); }
+
+  // 可以在任意线程调用
+  void snapshot(LoopStatsSnapshot *out) const;
+
+private:
+  std::atomic<uint64_t> iterations_;
+  Histogram pollNs_;
+  Histogram callbackNs_;
+  Histogram functorNs_;
+  Histogram events_;
+  Histogram queueDepth_;
+  Histogram timerLagUs_;
+};
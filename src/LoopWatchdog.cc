@@ -0,0 +1,274 @@
+#include "LoopWatchdog.h"
+#include "EventLoop.h"
+#include "Channel.h"
+#include "LoopStats.h"
+#include "Logger.h"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+  const int kMaxFrames = 64;
+  const int kCaptureWaitMs = 100; // 等待loop线程响应信号的最长时间
+
+  enum CaptureState
+  {
+    kIdle,
+    kRequested,
+    kCapturing,
+    kCaptured
+  };
+
+  // 信号处理函数与看门狗线程之间交换调用栈，同一时间只有一次抓取
+  struct Capture
+  {
+    std::atomic<int> state{kIdle};
+    EventLoop *loop = nullptr;
+    char owner[128];
+    void *frames[kMaxFrames];
+    int depth = 0;
+  };
+
+  Capture g_capture;
+  std::mutex g_captureMutex;
+
+  // 在loop线程中执行，只做异步信号安全的操作
+  // 此时正在处理的channel不会被析构（连接的销毁放在投递回调中），可以读它的名字
+  void stallSignalHandler(int)
+  {
+    // 超时撤回后迟到的信号可能落在其他loop线程上
+    int expected = kRequested;
+    if (!g_capture.loop->isInLoopThread() || !g_capture.state.compare_exchange_strong(expected, kCapturing))
+    {
+      return;
+    }
+    g_capture.owner[0] = '\0';
+    Channel *channel = g_capture.loop->currentChannel();
+    if (channel && channel->ownerName())
+    {
+      strncpy(g_capture.owner, channel->ownerName(), sizeof(g_capture.owner) - 1);
+      g_capture.owner[sizeof(g_capture.owner) - 1] = '\0';
+    }
+    g_capture.depth = ::backtrace(g_capture.frames, kMaxFrames);
+    g_capture.state.store(kCaptured, std::memory_order_release);
+  }
+
+  std::string demangle(const char *name)
+  {
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if (status != 0 || !demangled)
+    {
+      return name;
+    }
+    std::string result(demangled);
+    free(demangled);
+    return result;
+  }
+
+  std::string symbolize(const void *address)
+  {
+    Dl_info info;
+    if (::dladdr(address, &info) && info.dli_sname)
+    {
+      return demangle(info.dli_sname);
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%p", address);
+    return buf;
+  }
+
+  // backtrace_symbols的格式为 module(mangled+offset) [address]
+  std::string demangleFrame(const char *frame)
+  {
+    const char *begin = strchr(frame, '(');
+    const char *end = begin ? strchr(begin, '+') : nullptr;
+    if (!begin || !end || end == begin + 1)
+    {
+      return frame;
+    }
+    std::string mangled(begin + 1, end);
+    return std::string(frame, begin + 1) + demangle(mangled.c_str()) + end;
+  }
+}
+
+LoopWatchdog::LoopWatchdog(int thresholdMs)
+    : thresholdNs_(static_cast<int64_t>(thresholdMs) * 1000 * 1000),
+      signo_(SIGRTMIN + 1),
+      stallsDetected_(0),
+      running_(false),
+      thread_(std::bind(&LoopWatchdog::threadFunc, this), "LoopWatchdog")
+{
+}
+
+LoopWatchdog::~LoopWatchdog()
+{
+  stop();
+}
+
+void LoopWatchdog::watch(EventLoop *loop)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  loops_.push_back(Watched{loop, 0});
+}
+
+void LoopWatchdog::unwatch(EventLoop *loop)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  loops_.erase(std::remove_if(loops_.begin(), loops_.end(), [loop](const Watched &w)
+                              { return w.loop == loop; }),
+               loops_.end());
+}
+
+void LoopWatchdog::start()
+{
+  if (signo_ > 0)
+  {
+    // backtrace第一次调用时会加载libgcc，不能发生在信号处理函数中
+    void *frames[2];
+    ::backtrace(frames, 2);
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stallSignalHandler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (::sigaction(signo_, &sa, nullptr) < 0)
+    {
+      LOG_ERROR("LoopWatchdog sigaction %d failed: %d", signo_, errno)
+      signo_ = 0;
+    }
+  }
+  running_ = true;
+  thread_.start();
+}
+
+void LoopWatchdog::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_)
+    {
+      return;
+    }
+    running_ = false;
+  }
+  cond_.notify_one();
+  thread_.join();
+}
+
+void LoopWatchdog::threadFunc()
+{
+  std::chrono::milliseconds interval(std::max<int64_t>(thresholdNs_ / 4 / 1000 / 1000, 1));
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_)
+  {
+    cond_.wait_for(lock, interval);
+    if (running_)
+    {
+      check();
+    }
+  }
+}
+
+// 持有mutex_，被监视的loop在此期间不会被unwatch
+void LoopWatchdog::check()
+{
+  int64_t now = LoopStats::nowNanos();
+  for (Watched &w : loops_)
+  {
+    int64_t since = w.loop->busySinceNs();
+    if (since == 0 || since == w.reportedSince || now - since < thresholdNs_)
+    {
+      continue;
+    }
+    w.reportedSince = since;
+    stallsDetected_.fetch_add(1, std::memory_order_relaxed);
+    report(w.loop, now - since, w.loop->currentFd(), w.loop->currentFunctor());
+  }
+}
+
+void LoopWatchdog::report(EventLoop *loop, int64_t stalledNs, int fd, const void *functor)
+{
+  StallReport report;
+  report.loop = loop;
+  report.stalledMs = stalledNs / 1000 / 1000;
+  report.fd = fd;
+  if (functor)
+  {
+    report.functor = symbolize(functor);
+  }
+  if (signo_ > 0 && !captureBacktrace(loop, &report))
+  {
+    LOG_ERROR("LoopWatchdog failed to capture backtrace of EventLoop %p", loop)
+  }
+
+  if (stallCallback_)
+  {
+    stallCallback_(report);
+    return;
+  }
+  LOG_ERROR("EventLoop %p stalled for %ld ms, fd=%d owner=%s functor=%s", loop, report.stalledMs, report.fd,
+            report.owner.empty() ? "-" : report.owner.c_str(), report.functor.empty() ? "-" : report.functor.c_str())
+  for (const std::string &frame : report.backtrace)
+  {
+    LOG_ERROR("    %s", frame.c_str())
+  }
+}
+
+bool LoopWatchdog::captureBacktrace(EventLoop *loop, StallReport *report)
+{
+  std::lock_guard<std::mutex> lock(g_captureMutex);
+  g_capture.loop = loop;
+  g_capture.state.store(kRequested);
+  if (::pthread_kill(loop->threadHandle(), signo_) != 0)
+  {
+    g_capture.state.store(kIdle);
+    return false;
+  }
+
+  int state = kRequested;
+  for (int i = 0; i < kCaptureWaitMs; ++i)
+  {
+    state = g_capture.state.load(std::memory_order_acquire);
+    if (state == kCaptured)
+    {
+      break;
+    }
+    ::usleep(1000);
+  }
+  // 超时后撤回请求，信号处理函数已经开始抓取时等它完成
+  if (state != kCaptured)
+  {
+    int expected = kRequested;
+    if (g_capture.state.compare_exchange_strong(expected, kIdle))
+    {
+      return false;
+    }
+    while (g_capture.state.load(std::memory_order_acquire) != kCaptured)
+    {
+      ::usleep(1000);
+    }
+  }
+
+  report->owner = g_capture.owner;
+  char **symbols = ::backtrace_symbols(g_capture.frames, g_capture.depth);
+  if (symbols)
+  {
+    // 跳过信号处理函数自身和信号返回的frame
+    for (int i = 2; i < g_capture.depth; ++i)
+    {
+      report->backtrace.push_back(demangleFrame(symbols[i]));
+    }
+    free(symbols);
+  }
+  g_capture.state.store(kIdle);
+  return true;
+}
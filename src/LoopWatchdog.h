@@ -0,0 +1,76 @@
+#pragma once
+
+#include "nocopyable.h"
+#include "Thread.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class EventLoop;
+
+// 一次卡顿的报告
+struct StallReport
+{
+  EventLoop *loop;
+  int64_t stalledMs;                  // 发现卡顿时本轮已经处理了多久
+  int fd;                             // 正在处理事件的channel的fd，-1表示不在处理channel
+  std::string owner;                  // channel所属的连接名
+  std::string functor;                // 正在执行的投递回调的符号
+  std::vector<std::string> backtrace; // loop线程的调用栈
+};
+
+// 卡顿看门狗：独立线程周期性地检查被监视的EventLoop，
+// 一轮迭代（poll返回之后到下一次poll之前）超过阈值时报告正在处理的fd、连接名或投递回调，
+// 并向loop线程发送信号，在信号处理函数中抓取调用栈
+// loop线程的正常路径只在每个回调前做几次relaxed的原子写，见EventLoop::currentFd等
+// 被监视的loop析构之前要先unwatch或者停止看门狗
+class LoopWatchdog : nocopyable
+{
+public:
+  using StallCallback = std::function<void(const StallReport &)>;
+
+  explicit LoopWatchdog(int thresholdMs = 100);
+  ~LoopWatchdog();
+
+  // 可以在任意线程调用，如TcpServer的ThreadInitCallback
+  void watch(EventLoop *loop);
+  void unwatch(EventLoop *loop);
+
+  // 默认用LOG_ERROR打印报告
+  void setStallCallback(StallCallback cb) { stallCallback_ = std::move(cb); }
+  // 用于抓取调用栈的信号，默认SIGRTMIN + 1，0表示不抓取调用栈，需在start之前设置
+  void setBacktraceSignal(int signo) { signo_ = signo; }
+
+  void start();
+  void stop();
+
+  int64_t stallsDetected() const { return stallsDetected_.load(std::memory_order_relaxed); }
+
+private:
+  struct Watched
+  {
+    EventLoop *loop;
+    int64_t reportedSince; // 已经报告过的一轮，同一轮只报告一次
+  };
+
+  void threadFunc();
+  void check();
+  void report(EventLoop *loop, int64_t stalledNs, int fd, const void *functor);
+  bool captureBacktrace(EventLoop *loop, StallReport *report);
+
+  const int64_t thresholdNs_;
+  int signo_;
+  StallCallback stallCallback_;
+  std::atomic<int64_t> stallsDetected_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool running_;
+  std::vector<Watched> loops_;
+  Thread thread_;
+};
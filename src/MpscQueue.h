@@ -0,0 +1,150 @@
+#pragma once
+
+#include "nocopyable.h"
+
+#include <atomic>
+#include <new>
+#include <utility>
+#include <stddef.h>
+#include <stdint.h>
+
+// 无锁的多生产者单消费者无界队列，由多个定长的block串成链表（类似crossbeam的SegQueue）
+// 生产者用CAS在tailIndex_上占一个槽，写入元素后置ready；占到block最后一个槽的生产者负责挂上下一个block
+// 每kBlockCap个元素才分配一次block，消费者用完的block放回spare_给生产者复用，稳定状态下不分配内存
+// push可以在任意线程调用，consume/empty只能由唯一的消费者线程调用
+template <typename T>
+class MpscQueue : nocopyable
+{
+public:
+  MpscQueue()
+      : tailIndex_(0),
+        tailBlock_(new Block),
+        headIndex_(0),
+        spare_(nullptr)
+  {
+    headBlock_ = tailBlock_.load(std::memory_order_relaxed);
+  }
+
+  ~MpscQueue()
+  {
+    consume([](T &) {});
+    delete headBlock_;
+    delete spare_.load(std::memory_order_relaxed);
+  }
+
+  void push(T value)
+  {
+    Block *next = nullptr; // 预先分配的下一个block
+    uint64_t tail = tailIndex_.load(std::memory_order_acquire);
+    Block *block = tailBlock_.load(std::memory_order_acquire);
+    for (;;)
+    {
+      size_t offset = tail % kLap;
+      if (offset == kBlockCap)
+      {
+        // 其他生产者正在挂下一个block
+        tail = tailIndex_.load(std::memory_order_acquire);
+        block = tailBlock_.load(std::memory_order_acquire);
+        continue;
+      }
+      if (offset + 1 == kBlockCap && !next)
+      {
+        next = allocateBlock();
+      }
+      if (tailIndex_.compare_exchange_weak(tail, tail + 1, std::memory_order_seq_cst, std::memory_order_acquire))
+      {
+        if (offset + 1 == kBlockCap)
+        {
+          tailBlock_.store(next, std::memory_order_release);
+          tailIndex_.fetch_add(1, std::memory_order_release); // 跳过offset == kBlockCap的位置
+          block->next.store(next, std::memory_order_release);
+          next = nullptr;
+        }
+        Slot &slot = block->slots[offset];
+        new (slot.storage) T(std::move(value));
+        slot.ready.store(true, std::memory_order_release);
+        if (next)
+        {
+          recycleBlock(next);
+        }
+        return;
+      }
+      block = tailBlock_.load(std::memory_order_acquire);
+    }
+  }
+
+  // 依次消费调用时已经入队的元素，消费过程中新push的元素留到下一次
+  // 遇到已经占位但还没写完的槽时提前结束，该生产者push返回后会自行通知消费者
+  template <typename Func>
+  size_t consume(Func &&func)
+  {
+    uint64_t limit = tailIndex_.load(std::memory_order_acquire);
+    size_t count = 0;
+    while (headIndex_ < limit)
+    {
+      size_t offset = headIndex_ % kLap;
+      Slot &slot = headBlock_->slots[offset];
+      if (!slot.ready.load(std::memory_order_acquire))
+      {
+        break;
+      }
+      T *ptr = reinterpret_cast<T *>(slot.storage);
+      T value(std::move(*ptr));
+      ptr->~T();
+      slot.ready.store(false, std::memory_order_relaxed);
+      if (offset + 1 == kBlockCap)
+      {
+        // 最后一个槽ready时下一个block一定已经挂上
+        Block *next = headBlock_->next.load(std::memory_order_acquire);
+        recycleBlock(headBlock_);
+        headBlock_ = next;
+        headIndex_ += 2;
+      }
+      else
+      {
+        ++headIndex_;
+      }
+      ++count;
+      func(value);
+    }
+    return count;
+  }
+
+  // 有生产者已经占位也算非空
+  bool empty() const { return tailIndex_.load(std::memory_order_acquire) == headIndex_; }
+
+private:
+  static const size_t kLap = 64;
+  static const size_t kBlockCap = kLap - 1;
+
+  struct Slot
+  {
+    std::atomic_bool ready{false};
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  struct Block
+  {
+    std::atomic<Block *> next{nullptr};
+    Slot slots[kBlockCap];
+  };
+
+  Block *allocateBlock()
+  {
+    Block *block = spare_.exchange(nullptr, std::memory_order_acquire);
+    return block ? block : new Block;
+  }
+
+  void recycleBlock(Block *block)
+  {
+    block->next.store(nullptr, std::memory_order_relaxed);
+    delete spare_.exchange(block, std::memory_order_acq_rel);
+  }
+
+  // 生产者竞争的一端，与消费者的状态放在不同的cache line
+  alignas(64) std::atomic<uint64_t> tailIndex_;
+  std::atomic<Block *> tailBlock_;
+  alignas(64) uint64_t headIndex_;
+  Block *headBlock_;
+  std::atomic<Block *> spare_; // 一个可复用的空block
+};
@@ -1,7 +1,7 @@
 #include "Poller.h"
 #include "Channel.h"
 
-Poller::Poller(EventLoop *loop) : ownerLoop_(loop)
+Poller::Poller(EventLoop *loop) : syscalls_(0), updatesAvoided_(0), ownerLoop_(loop)
 {
 }
 
@@ -5,6 +5,7 @@
 
 #include <vector>
 #include <unordered_map>
+#include <stdint.h>
 
 class Channel;
 class EventLoop;
@@ -23,6 +24,10 @@ public:
   virtual void updateChannel(Channel *channel) = 0;
   virtual void removeChannel(Channel *channel) = 0;
   bool hasChannel(Channel *channel) const;
+  // poller发起的系统调用次数（epoll_wait、epoll_ctl或io_uring_enter）
+  int64_t syscalls() const { return syscalls_; }
+  // 合并或抵消掉的事件修改次数，即省下的epoll_ctl调用
+  int64_t updatesAvoided() const { return updatesAvoided_; }
 
   // 启动Poller，具体使用的是Epoll接口还是Poll接口
   // 实现在DefaultPoller.cc中，因为要拿到派生类的实例，基类最后不要include派生类
@@ -31,6 +36,8 @@ public:
 protected:
   using ChannelMap = std::unordered_map<int, Channel *>; // 文件fd和channel映射表
   ChannelMap channels_;                                  // 添加到poller的channel
+  int64_t syscalls_;
+  int64_t updatesAvoided_;
 
 private:
   EventLoop *ownerLoop_; // Poller所属的Eventloop
@@ -73,4 +73,25 @@ void Socket::setKeepAlive(bool on)
 {
   int optval = on ? 1 : 0;
   ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof(optval));
-}
\ No newline at end of file
+}
+
+bool Socket::setZeroCopy(bool on)
+{
+  int optval = on ? 1 : 0;
+  if (::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof(optval)) < 0)
+  {
+    LOG_ERROR("setZeroCopy sockfd: %d failed: %d", sockfd_, errno)
+    return false;
+  }
+  return true;
+}
+
+bool Socket::setBusyPoll(int microseconds)
+{
+  if (::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL, &microseconds, sizeof(microseconds)) < 0)
+  {
+    LOG_ERROR("setBusyPoll sockfd: %d failed: %d", sockfd_, errno)
+    return false;
+  }
+  return true;
+}
@@ -20,6 +20,8 @@ public:
   void setReuseAddr(bool on);
   void setReusePort(bool on);
   void setKeepAlive(bool on);
+  bool setZeroCopy(bool on); // SO_ZEROCOPY，内核不支持时返回false
+  bool setBusyPoll(int microseconds); // SO_BUSY_POLL，调大可能需要CAP_NET_ADMIN
 
 private:
   const int sockfd_;
@@ -3,9 +3,15 @@
 #include "Socket.h"
 #include "EventLoop.h"
 #include "Logger.h"
+#include "BufferPool.h"
+#include "Tracer.h"
 
 #include <functional>
 #include <sys/types.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
 
 void defaultConnectionCallback(const TcpConnectionPtr &conn)
 {
@@ -19,24 +25,46 @@ void defaultMessageCallback(const TcpConnectionPtr &,
   buf->retrieveAll();
 }
 
-TcpConnection::TcpConnection(EventLoop *loop, const std::string &name, int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr)
+TcpConnection::TcpConnection(EventLoop *loop, const std::string &name, int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr, bool lowFootprint)
     : loop_(loop),
       name_(name),
       stat_(kConnecting),
       reading_(true),
+      lowFootprint_(lowFootprint),
       socket_(new Socket(sockfd)),
       channel_(new Channel(loop, sockfd)),
       localAddr_(localAddr),
       peerAddr_(peerAddr),
-      highWaterMark_(64 * 1024 * 1024)
+      highWaterMark_(64 * 1024 * 1024),
+      lowWaterMark_(0),
+      autoPauseRead_(false),
+      readPause_(0),
+      accountedBytes_(0),
+      inputBuffer_(loop->bufferPool(), lowFootprint ? 0 : Buffer::kInitialSize),
+      outputBuffer_(loop->bufferPool(), lowFootprint ? 0 : Buffer::kInitialSize),
+      shrinkScheduled_(false),
+      chainedOutput_(false),
+      segmentsBufferedBytes_(0),
+      zeroCopyThreshold_(0),
+      zeroCopyNextId_(0),
+      zeroCopySends_(0),
+      zeroCopyCompletions_(0),
+      zeroCopyCopied_(0),
+      flushQueued_(false),
+      idleTimeoutSeconds_(0)
 {
   channel_->setReadCallback(std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
   channel_->setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
   channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
   channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
+  channel_->setOwnerName(name_.c_str());
 
   LOG_INFO("TcpConnection::ctor[%s] at fd=%d", name.c_str(), sockfd)
   socket_->setKeepAlive(true);
+  if (loop->socketBusyPoll() > 0)
+  {
+    socket_->setBusyPoll(loop->socketBusyPoll());
+  }
 }
 
 TcpConnection::~TcpConnection()
@@ -44,6 +72,11 @@ TcpConnection::~TcpConnection()
   LOG_INFO("TcpConnection::dtor[%s] at fd=%d state=%d", name_.c_str(), channel_->fd(), (int)stat_)
 }
 
+void TcpConnection::setTcpNoDelay(bool on)
+{
+  socket_->setTcpNoDelay(on);
+}
+
 void TcpConnection::send(const std::string &buf)
 {
   if (stat_ == kConnected)
@@ -54,7 +87,96 @@ void TcpConnection::send(const std::string &buf)
     }
     else
     {
-      loop_->runInLoop(std::bind(&TcpConnection::sendInLoop, this, buf.c_str(), buf.size()));
+      // 调用者不需要保证buf在sendInLoop执行时仍然有效，拷贝一份交给loop
+      send(std::string(buf));
+    }
+  }
+}
+
+void TcpConnection::send(const void *data, size_t len)
+{
+  if (stat_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendInLoop(data, len);
+    }
+    else
+    {
+      send(std::string(static_cast<const char *>(data), len));
+    }
+  }
+}
+
+void TcpConnection::send(std::string &&message)
+{
+  if (stat_ == kConnected)
+  {
+    if (useZeroCopy(message.size()))
+    {
+      // 数据需要保留到完成通知到达，move到SharedBlock中
+      send(std::make_shared<const std::string>(std::move(message)));
+    }
+    else if (loop_->isInLoopThread())
+    {
+      sendInLoop(message.data(), message.size());
+    }
+    else
+    {
+      TcpConnectionPtr self(shared_from_this());
+      loop_->runInLoop([self, message = std::move(message)]()
+                       { self->sendInLoop(message.data(), message.size()); });
+    }
+  }
+}
+
+void TcpConnection::send(Buffer &&buf)
+{
+  if (stat_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendInLoop(buf.peek(), buf.readableBytes(), &buf);
+    }
+    else
+    {
+      // buf的存储可能来自调用者所在loop的pool，那个loop可能先退出，交给本连接的loop之前解除关联，之后的释放走free
+      buf.detachPool();
+      TcpConnectionPtr self(shared_from_this());
+      loop_->runInLoop([self, buf = std::move(buf)]() mutable
+                       { self->sendInLoop(buf.peek(), buf.readableBytes(), &buf); });
+    }
+  }
+}
+
+void TcpConnection::send(const SharedBlock &block)
+{
+  if (stat_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendBlockInLoop(block);
+    }
+    else
+    {
+      TcpConnectionPtr self(shared_from_this());
+      loop_->runInLoop([self, block]()
+                       { self->sendBlockInLoop(block); });
+    }
+  }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t length)
+{
+  if (stat_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendFileInLoop(fd, offset, length);
+    }
+    else
+    {
+      loop_->runInLoop(std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), fd, offset, length));
     }
   }
 }
@@ -68,11 +190,94 @@ void TcpConnection::shutdown()
   }
 }
 
+void TcpConnection::startRead()
+{
+  loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::stopRead()
+{
+  loop_->runInLoop(std::bind(&TcpConnection::stopReadInLoop, shared_from_this()));
+}
+
+void TcpConnection::startReadInLoop()
+{
+  reading_.store(true, std::memory_order_relaxed);
+  resumeRead(kPausedByUser);
+}
+
+void TcpConnection::stopReadInLoop()
+{
+  reading_.store(false, std::memory_order_relaxed);
+  pauseRead(kPausedByUser);
+}
+
+void TcpConnection::setWaterMarks(size_t highWaterMark, size_t lowWaterMark)
+{
+  highWaterMark_ = highWaterMark;
+  lowWaterMark_ = lowWaterMark;
+  autoPauseRead_ = true;
+}
+
+void TcpConnection::pauseRead(int reason)
+{
+  readPause_ |= reason;
+  updateReading();
+}
+
+void TcpConnection::resumeRead(int reason)
+{
+  readPause_ &= ~reason;
+  updateReading();
+}
+
+void TcpConnection::updateReading()
+{
+  if (stat_ != kConnected && stat_ != kDisconnecting)
+  {
+    return;
+  }
+  if (readPause_ == 0 && !channel_->isReading())
+  {
+    channel_->enableReading();
+  }
+  else if (readPause_ != 0 && channel_->isReading())
+  {
+    channel_->disableReading();
+  }
+}
+
+// 发送缓冲区降到低水位及以下，恢复因高水位停止的读
+void TcpConnection::checkLowWaterMark()
+{
+  if ((readPause_ & kPausedByWaterMark) && outputBytes() <= lowWaterMark_)
+  {
+    resumeRead(kPausedByWaterMark);
+    if (lowWaterMarkCallback_)
+    {
+      loop_->queueInLoop(std::bind(lowWaterMarkCallback_, shared_from_this(), outputBytes()));
+    }
+  }
+}
+
+void TcpConnection::updateBufferAccounting()
+{
+  size_t bytes = inputBuffer_.readableBytes() + outputBytes();
+  if (bytes != accountedBytes_)
+  {
+    loop_->adjustBufferedBytes(static_cast<ssize_t>(bytes) - static_cast<ssize_t>(accountedBytes_));
+    accountedBytes_ = bytes;
+  }
+}
+
 void TcpConnection::connectEstablished()
 {
   setState(kConnected);
   channel_->tie(shared_from_this());
-  channel_->enableReading();
+  if (readPause_ == 0)
+  {
+    channel_->enableReading();
+  }
 
   connectionCallback_(shared_from_this());
 }
@@ -86,6 +291,12 @@ void TcpConnection::connectDestroyed()
     connectionCallback_(shared_from_this());
   }
   channel_->remove();
+  cancelIdleTimeout();
+  loop_->adjustBufferedBytes(-static_cast<ssize_t>(accountedBytes_));
+  accountedBytes_ = 0;
+  // 连接可能在其他线程析构，提前与loop的pool解除关联
+  inputBuffer_.detachPool();
+  outputBuffer_.detachPool();
 }
 
 void TcpConnection::forceClose()
@@ -105,49 +316,231 @@ void TcpConnection::forceCloseInLoop()
   }
 }
 
+void TcpConnection::setEdgeTriggered(bool on)
+{
+  channel_->setEdgeTriggered(on);
+}
+
+bool TcpConnection::edgeTriggered() const
+{
+  return channel_->edgeTriggered();
+}
+
+void TcpConnection::setIdleTimeout(int seconds)
+{
+  loop_->runInLoop(std::bind(&TcpConnection::setIdleTimeoutInLoop, shared_from_this(), seconds));
+}
+
+void TcpConnection::setIdleTimeoutInLoop(int seconds)
+{
+  idleTimeoutSeconds_ = seconds;
+  if (seconds <= 0)
+  {
+    cancelIdleTimeout();
+    return;
+  }
+  if (stat_ != kConnected)
+  {
+    return;
+  }
+  if (!idleEntry_.linked())
+  {
+    // 回调只在loop线程中执行，连接从时间轮上摘下之后才会析构
+    idleEntry_.setExpireCallback([this]()
+                                 { handleIdleTimeout(); });
+  }
+  loop_->timingWheel()->arm(&idleEntry_, seconds * 1000);
+}
+
+void TcpConnection::touchIdleTimeout()
+{
+  if (idleEntry_.linked())
+  {
+    loop_->timingWheel()->refresh(&idleEntry_);
+  }
+}
+
+void TcpConnection::cancelIdleTimeout()
+{
+  if (idleEntry_.linked())
+  {
+    loop_->timingWheel()->cancel(&idleEntry_);
+  }
+}
+
+void TcpConnection::handleIdleTimeout()
+{
+  LOG_INFO("TcpConnection::handleIdleTimeout [%s] idle for %d seconds, closing", name_.c_str(), idleTimeoutSeconds_)
+  forceCloseInLoop();
+}
+
 void TcpConnection::handleRead(Timestamp receiveTime)
+{
+  if (!channel_->edgeTriggered())
+  {
+    readOnce(receiveTime, nullptr);
+    return;
+  }
+
+  // 边缘触发：一直读到内核缓冲区读空，每轮最多读预算字节，还有数据时放进loop的就绪列表下一轮继续
+  // 已经暂停读或者已经关闭的连接不读；半关闭（kDisconnecting）时还要读，才能收到对端的关闭
+  if (readPause_ != 0 || (stat_ != kConnected && stat_ != kDisconnecting))
+  {
+    return;
+  }
+  size_t budget = loop_->edgeTriggeredBudget();
+  size_t total = 0;
+  for (;;)
+  {
+    bool drained = false;
+    ssize_t n = readOnce(receiveTime, &drained);
+    if (n <= 0 || drained || readPause_ != 0 || (stat_ != kConnected && stat_ != kDisconnecting))
+    {
+      break;
+    }
+    total += n;
+    if (total >= budget)
+    {
+      loop_->addReadyChannel(channel_.get(), Channel::kReadEvent);
+      break;
+    }
+  }
+}
+
+// 读一次数据并回调，drained返回内核缓冲区是否已经读空
+ssize_t TcpConnection::readOnce(Timestamp receiveTime, bool *drained)
 {
   int savedErrno = 0;
+  if (!lowFootprint_)
+  {
+    // 按预测的大小预留可写空间，使数据直接读到inputBuffer_中，而不是先读到溢出区再拷贝
+    inputBuffer_.ensureWritableBytes(readSize_.guess());
+  }
+  size_t capacity = inputBuffer_.readFdCapacity();
   ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+  if (drained)
+  {
+    *drained = (n >= 0 && static_cast<size_t>(n) < capacity) || (n < 0 && savedErrno == EAGAIN);
+  }
   if (n > 0)
   {
+    lastBufferActivity_ = receiveTime;
+    touchIdleTimeout();
+    readSize_.record(n);
     messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    if (inputBuffer_.readableBytes() == 0)
+    {
+      // 预测值变小后，及时收缩过大的inputBuffer_
+      if (!lowFootprint_ && inputBuffer_.internalCapacity() > 2 * BufferPool::roundUp(Buffer::kCheapPrepend + readSize_.guess()))
+      {
+        inputBuffer_.shrink(readSize_.guess());
+      }
+      scheduleBufferShrink();
+    }
+    updateBufferAccounting();
+    if (loop_->overMemoryBudget() && !(readPause_ & kPausedByBudget))
+    {
+      // loop上缓冲的数据太多，暂停读，等总量降下来之后由loop恢复
+      pauseRead(kPausedByBudget);
+      std::weak_ptr<TcpConnection> weakConn(shared_from_this());
+      loop_->queueBudgetResume([weakConn]()
+                               {
+                                 TcpConnectionPtr conn = weakConn.lock();
+                                 if (conn)
+                                 {
+                                   conn->resumeRead(kPausedByBudget);
+                                 } });
+    }
   }
   else if (n == 0)
   {
     handleClose();
   }
-  else
+  else if (savedErrno != EAGAIN)
   {
     errno = savedErrno;
     LOG_ERROR("TcpConnection::handleRead")
     handleError();
   }
+  return n;
 }
 
 void TcpConnection::handleWrite()
 {
-  if (channel_->isWriting())
+  TraceSpan span("handleWrite", channel_->fd());
+  if (!channel_->isWriting())
   {
-    int saveErrno = 0;
-    ssize_t n = ::write(channel_->fd(), outputBuffer_.peek(), outputBuffer_.readableBytes());
-    if (n > 0)
+    return;
+  }
+  if (!channel_->edgeTriggered())
+  {
+    flushOutput();
+    return;
+  }
+
+  // 边缘触发：一直写到EAGAIN或者写完，每轮最多写预算字节
+  size_t budget = loop_->edgeTriggeredBudget();
+  size_t total = 0;
+  while (channel_->isWriting())
+  {
+    ssize_t n = flushOutput();
+    // 返回0时可能只是弹出了一个读到文件末尾或者长度为0的段，后面还有待发送的数据，不会再有新的边缘，要继续写
+    if (n < 0 || (n == 0 && !hasPendingOutput()))
     {
-      outputBuffer_.retrieve(n);
-      if (outputBuffer_.readableBytes() == 0)
+      break;
+    }
+    total += n;
+    if (total >= budget)
+    {
+      if (channel_->isWriting())
+      {
+        loop_->addReadyChannel(channel_.get(), Channel::kWriteEvent);
+      }
+      break;
+    }
+  }
+}
+
+// 写一次待发送的数据，写完了则取消关注写事件，没写完则开始关注写事件，返回写出的字节数
+ssize_t TcpConnection::flushOutput()
+{
+  int saveErrno = 0;
+  ssize_t n = writeOutput(&saveErrno);
+  updateBufferAccounting();
+  if (n >= 0)
+  {
+    lastBufferActivity_ = loop_->pollReturnTime();
+    touchIdleTimeout();
+    checkLowWaterMark();
+    if (!hasPendingOutput())
+    {
+      if (channel_->isWriting())
       {
         channel_->disableWriting();
-        if (writeCompleteCallback_)
-        {
-          loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
-        }
-        if (stat_ == kDisconnecting)
-        {
-          shutdownInLoop();
-        }
       }
+      scheduleBufferShrink();
+      if (writeCompleteCallback_)
+      {
+        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+      }
+      if (stat_ == kDisconnecting)
+      {
+        shutdownInLoop();
+      }
+      return n;
     }
   }
+  else if (saveErrno != EAGAIN)
+  {
+    errno = saveErrno;
+    LOG_ERROR("TcpConnection::handleWrite")
+  }
+
+  if (!channel_->isWriting())
+  {
+    channel_->enableWriting();
+  }
+  return n;
 }
 
 void TcpConnection::handleClose()
@@ -155,6 +548,7 @@ void TcpConnection::handleClose()
   LOG_INFO("TcpConnection::handleClose fd=%d state=%d", channel_->fd(), (int)stat_)
   setState(kDisconnected);
   channel_->disableAll();
+  cancelIdleTimeout();
   TcpConnectionPtr connPtr(shared_from_this());
   connectionCallback_(connPtr);
   closeCallback_(connPtr);
@@ -162,6 +556,12 @@ void TcpConnection::handleClose()
 
 void TcpConnection::handleError()
 {
+  if (zeroCopyThreshold_.load(std::memory_order_relaxed) > 0 || !zeroCopyPinned_.empty())
+  {
+    // MSG_ZEROCOPY的完成通知通过错误队列以EPOLLERR的形式上报，并不是连接出错
+    handleZeroCopyCompletions();
+  }
+
   int optval;
   socklen_t optlen = sizeof(optval);
   int err = 0;
@@ -173,11 +573,21 @@ void TcpConnection::handleError()
   {
     err = optval;
   }
+  if (err == 0 && zeroCopyThreshold_.load(std::memory_order_relaxed) > 0)
+  {
+    return;
+  }
   LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d", name_.c_str(), err)
 }
 
 void TcpConnection::sendInLoop(const void *data, size_t len)
 {
+  sendInLoop(data, len, nullptr);
+}
+
+void TcpConnection::sendInLoop(const void *data, size_t len, Buffer *owner)
+{
+  TraceSpan span("sendInLoop", len);
   ssize_t nwrote = 0;
   size_t remaining = len;
   bool faultError = false;
@@ -188,11 +598,18 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
     return;
   }
 
-  if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+  // 开启了写合并：事件处理期间的send先暂存到发送缓冲区，本次迭代结束时统一写一次
+  bool staging = flushQueued_ || (!channel_->isWriting() && !hasPendingOutput() && loop_->coalescingWrites());
+  if (staging)
+  {
+    loop_->countCoalescedSend();
+  }
+  else if (!channel_->isWriting() && !hasPendingOutput())
   {
     nwrote = ::write(channel_->fd(), data, len);
     if (nwrote >= 0)
     {
+      touchIdleTimeout();
       remaining = len - nwrote;
       if (remaining == 0 && writeCompleteCallback_)
       {
@@ -215,24 +632,334 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
 
   if (!faultError && remaining > 0)
   {
-    size_t oldLen = outputBuffer_.readableBytes();
-    if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
+    size_t oldLen = outputBytes();
+    if (oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_)
+    {
+      if (autoPauseRead_)
+      {
+        pauseRead(kPausedByWaterMark);
+      }
+      if (highWaterMarkCallback_)
+      {
+        loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+      }
+    }
+    if (owner && !chainedOutput_ && oldLen == 0)
+    {
+      // 发送缓冲区为空，直接换入owner的存储，省去一次拷贝
+      owner->retrieve(nwrote);
+      outputBuffer_.swap(*owner);
+    }
+    else
+    {
+      appendOutput((char *)data + nwrote, remaining);
+    }
+    if (staging)
     {
-      loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
+      if (!flushQueued_)
+      {
+        flushQueued_ = true;
+        loop_->queueWriteFlush(std::bind(&TcpConnection::flushStaged, shared_from_this()));
+      }
     }
-    outputBuffer_.append((char *)data + nwrote, remaining);
-    if (!channel_->isWriting())
+    else if (!channel_->isWriting())
     {
       channel_->enableWriting();
     }
+    updateBufferAccounting();
+  }
+}
+
+void TcpConnection::flushStaged()
+{
+  flushQueued_ = false;
+  if (stat_ != kDisconnected && !channel_->isWriting())
+  {
+    flushOutput();
   }
 }
 
 void TcpConnection::shutdownInLoop()
 {
   // 如果socket上有数据没写完则暂时不关闭
-  if (!channel_->isWriting())
+  if (!channel_->isWriting() && !hasPendingOutput())
   {
     socket_->shutdownWrite();
   }
 }
+
+void TcpConnection::appendOutput(const char *data, size_t len)
+{
+  if (chainedOutput_)
+  {
+    outputChain_.append(data, len);
+  }
+  else
+  {
+    outputBuffer_.append(data, len);
+  }
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t length)
+{
+  if (stat_ == kDisconnected)
+  {
+    LOG_ERROR("disconnected, can't wrting")
+    return;
+  }
+  if (length == 0)
+  {
+    return;
+  }
+
+  queueSegment(PendingSegment{0, fd, offset, length, SharedBlock()});
+}
+
+void TcpConnection::sendBlockInLoop(const SharedBlock &block)
+{
+  if (!useZeroCopy(block->size()))
+  {
+    sendInLoop(block->data(), block->size());
+    return;
+  }
+
+  if (stat_ == kDisconnected)
+  {
+    LOG_ERROR("disconnected, can't wrting")
+    return;
+  }
+
+  queueSegment(PendingSegment{0, -1, 0, block->size(), block});
+}
+
+void TcpConnection::queueSegment(PendingSegment segment)
+{
+  segment.bytesBefore = outputBytes() - segmentsBufferedBytes_;
+  segmentsBufferedBytes_ += segment.bytesBefore;
+  pendingSegments_.push_back(std::move(segment));
+  if (!channel_->isWriting() && !flushQueued_)
+  {
+    // 之前没有待发送的数据，立即尝试发送一次
+    flushOutput();
+  }
+}
+
+void TcpConnection::setZeroCopyThreshold(size_t threshold)
+{
+  if (threshold > 0 && zeroCopyThreshold_.load(std::memory_order_relaxed) == 0 && !socket_->setZeroCopy(true))
+  {
+    return;
+  }
+  zeroCopyThreshold_.store(threshold, std::memory_order_relaxed);
+}
+
+// 读取socket错误队列中的MSG_ZEROCOPY完成通知，释放对应的数据块
+void TcpConnection::handleZeroCopyCompletions()
+{
+  char control[128];
+  while (true)
+  {
+    struct msghdr msg = {};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (::recvmsg(channel_->fd(), &msg, MSG_ERRQUEUE) < 0)
+    {
+      if (errno != EAGAIN)
+      {
+        LOG_ERROR("TcpConnection::handleZeroCopyCompletions recvmsg error: %d", errno)
+      }
+      break;
+    }
+
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm))
+    {
+      if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+            (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+      {
+        continue;
+      }
+      struct sock_extended_err *serr = reinterpret_cast<struct sock_extended_err *>(CMSG_DATA(cm));
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+      {
+        continue;
+      }
+
+      // [lo, hi]之间的send已经完成
+      uint32_t lo = serr->ee_info;
+      uint32_t hi = serr->ee_data;
+      zeroCopyCompletions_ += hi - lo + 1;
+      if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+      {
+        zeroCopyCopied_ += hi - lo + 1;
+      }
+      for (auto it = zeroCopyPinned_.begin(); it != zeroCopyPinned_.end();)
+      {
+        // 用差值比较，序号是32位回绕的
+        if (static_cast<int32_t>(it->first - lo) >= 0 && static_cast<int32_t>(hi - it->first) >= 0)
+        {
+          it = zeroCopyPinned_.erase(it);
+        }
+        else
+        {
+          ++it;
+        }
+      }
+    }
+  }
+}
+
+// 按顺序发送一次：先写出排在第一个文件之前的缓冲区数据，再sendfile该文件
+// 写出的部分已经从缓冲区/文件区间中去掉，返回本次写出的字节数
+ssize_t TcpConnection::writeOutput(int *saveErrno)
+{
+  if (pendingSegments_.empty())
+  {
+    return writeBuffer(saveErrno, static_cast<size_t>(-1));
+  }
+
+  PendingSegment &segment = pendingSegments_.front();
+  if (segment.bytesBefore > 0)
+  {
+    ssize_t n = writeBuffer(saveErrno, segment.bytesBefore);
+    if (n > 0)
+    {
+      segment.bytesBefore -= n;
+      segmentsBufferedBytes_ -= n;
+    }
+    return n;
+  }
+
+  ssize_t n = 0;
+  if (segment.block)
+  {
+    const char *data = segment.block->data() + segment.offset;
+    n = ::send(channel_->fd(), data, segment.remaining, MSG_ZEROCOPY | MSG_NOSIGNAL);
+    if (n > 0)
+    {
+      // 成功的send才会占用序号，数据块要保留到对应的完成通知到达
+      zeroCopyPinned_.emplace_back(zeroCopyNextId_++, segment.block);
+      ++zeroCopySends_;
+    }
+    else if (n < 0 && errno == ENOBUFS)
+    {
+      // 超出optmem限制，这一次退化为普通的send
+      n = ::send(channel_->fd(), data, segment.remaining, MSG_NOSIGNAL);
+    }
+  }
+  else
+  {
+    n = ::sendfile(channel_->fd(), segment.fd, &segment.offset, segment.remaining);
+    if (n == 0 && segment.remaining > 0)
+    {
+      // 文件比length短，剩余部分无法发送
+      LOG_ERROR("TcpConnection::writeOutput sendfile reached EOF of fd=%d, %lu bytes unsent", segment.fd, segment.remaining)
+      segment.remaining = 0;
+    }
+  }
+  if (n < 0)
+  {
+    *saveErrno = errno;
+    return n;
+  }
+
+  if (segment.block)
+  {
+    segment.offset += n;
+  }
+  segment.remaining -= n;
+  if (segment.remaining == 0)
+  {
+    pendingSegments_.pop_front();
+  }
+  return n;
+}
+
+ssize_t TcpConnection::writeBuffer(int *saveErrno, size_t maxBytes)
+{
+  if (chainedOutput_)
+  {
+    return outputChain_.writeFd(channel_->fd(), saveErrno, maxBytes);
+  }
+
+  ssize_t n = ::write(channel_->fd(), outputBuffer_.peek(), std::min(outputBuffer_.readableBytes(), maxBytes));
+  if (n < 0)
+  {
+    *saveErrno = errno;
+  }
+  else
+  {
+    outputBuffer_.retrieve(n);
+  }
+  return n;
+}
+
+static bool isOversized(const Buffer &buf)
+{
+  return buf.internalCapacity() > BufferPool::roundUp(Buffer::kCheapPrepend + Buffer::kInitialSize);
+}
+
+// 缓冲区被读空且容量超过初始大小时，安排一次空闲检查
+// lowFootprint模式下直接释放读空的缓冲区
+void TcpConnection::scheduleBufferShrink()
+{
+  if (lowFootprint_)
+  {
+    if (inputBuffer_.readableBytes() == 0)
+    {
+      inputBuffer_.shrink(0);
+    }
+    if (outputBuffer_.readableBytes() == 0)
+    {
+      outputBuffer_.shrink(0);
+    }
+    if (outputChain_.readableBytes() == 0)
+    {
+      outputChain_.shrink();
+    }
+    return;
+  }
+
+  int idleSeconds = loop_->bufferShrinkIdleSeconds();
+  if (idleSeconds <= 0 || shrinkScheduled_ ||
+      (!isOversized(inputBuffer_) && !isOversized(outputBuffer_) && outputChain_.numFreeBlocks() == 0))
+  {
+    return;
+  }
+
+  shrinkScheduled_ = true;
+  std::weak_ptr<TcpConnection> weakConn(shared_from_this());
+  loop_->runAfter(idleSeconds, [weakConn]()
+                  {
+                    TcpConnectionPtr conn = weakConn.lock();
+                    if (conn)
+                    {
+                      conn->shrinkIdleBuffers();
+                    } });
+}
+
+void TcpConnection::shrinkIdleBuffers()
+{
+  shrinkScheduled_ = false;
+  if (stat_ == kDisconnected)
+  {
+    return;
+  }
+
+  int idleSeconds = loop_->bufferShrinkIdleSeconds();
+  if (Timestamp::now() < addTime(lastBufferActivity_, idleSeconds))
+  {
+    // 期间有读写，重新计时
+    scheduleBufferShrink();
+    return;
+  }
+
+  if (inputBuffer_.readableBytes() == 0)
+  {
+    inputBuffer_.shrink(Buffer::kInitialSize);
+  }
+  if (outputBuffer_.readableBytes() == 0)
+  {
+    outputBuffer_.shrink(Buffer::kInitialSize);
+  }
+  outputChain_.shrink();
+}
\ No newline at end of file
@@ -4,11 +4,16 @@
 #include "InetAddress.h"
 #include "Timestamp.h"
 #include "Buffer.h"
+#include "ChainBuffer.h"
+#include "AdaptiveReadSize.h"
 #include "Callbacks.h"
+#include "TimingWheel.h"
 
 #include <memory>
 #include <string>
 #include <atomic>
+#include <list>
+#include <sys/types.h>
 
 class Channel;
 class EventLoop;
@@ -23,7 +28,8 @@ class Socket;
 class TcpConnection : nocopyable, public std::enable_shared_from_this<TcpConnection>
 {
 public:
-  TcpConnection(EventLoop *loop, const std::string &name, int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr);
+  // lowFootprint为true时输入输出缓冲区在有数据时才分配，读空/发送完后立即释放，适合大量空闲连接
+  TcpConnection(EventLoop *loop, const std::string &name, int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr, bool lowFootprint = false);
   ~TcpConnection();
 
   EventLoop *getLoop() const { return loop_; }
@@ -33,16 +39,61 @@ public:
 
   bool connected() const { return stat_ == kConnected; }
 
+  void setTcpNoDelay(bool on);
+
   void send(const std::string &buf);
+  void send(const void *data, size_t len);
+  // 以下重载接管数据的所有权，跨线程发送时数据被move到loop中，不再拷贝
+  void send(std::string &&message);
+  void send(Buffer &&buf); // 发送缓冲区为空时直接换入buf的存储
+  void send(const SharedBlock &block);
+  // 用sendfile发送文件fd中[offset, offset + length)的数据，按调用顺序排在之前send的数据之后
+  // fd由调用者管理，在writeCompleteCallback之前不能关闭
+  void sendFile(int fd, off_t offset, size_t length);
   void shutdown();
 
+  // 线程安全，停止/恢复读该连接上的数据
+  void startRead();
+  void stopRead();
+  // 只反映startRead/stopRead的状态，因高水位或内存预算暂停读时仍然返回true，可以在任意线程调用
+  bool isReading() const { return reading_.load(std::memory_order_relaxed); }
+
+  // 使用边缘触发，读写回调一直读写到EAGAIN，每轮最多读写loop的edgeTriggeredBudget字节
+  // 需在连接建立前或连接的loop线程中调用
+  void setEdgeTriggered(bool on);
+  bool edgeTriggered() const;
+
+  // 线程安全，连接上seconds秒没有读写活动则关闭连接，0表示取消
+  // 使用loop的时间轮，读写时刷新超时不分配内存，不会提前关闭，最多晚时间轮的一个tick
+  void setIdleTimeout(int seconds);
+
   // TODO: 为什么没使用std::move
   void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
   void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
   void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
   void setHighWaterMarkCallback(const HighWaterMarkCallback &cb) { highWaterMarkCallback_ = cb; }
+  void setLowWaterMarkCallback(const LowWaterMarkCallback &cb) { lowWaterMarkCallback_ = cb; }
   void setCloseCallback(const CloseCallback &cb) { closeCallback_ = cb; }
 
+  // 发送缓冲区超过highWaterMark时自动停止读该连接（并回调highWaterMarkCallback_），
+  // 降到lowWaterMark及以下时恢复读（并回调lowWaterMarkCallback_），需在连接的loop线程中调用
+  void setWaterMarks(size_t highWaterMark, size_t lowWaterMark);
+
+  // 使用分段的ChainBuffer作为发送缓冲区，需在有数据排队之前（连接建立前或连接的loop中）设置
+  void setChainedOutputBuffer(bool on) { chainedOutput_ = on; }
+  bool lowFootprint() const { return lowFootprint_; }
+  size_t outputBytes() const { return chainedOutput_ ? outputChain_.readableBytes() : outputBuffer_.readableBytes(); }
+  // 不小于threshold字节、且所有权交给连接的数据（send(std::string &&)、send(const SharedBlock &)）
+  // 使用MSG_ZEROCOPY发送，数据在内核的完成通知到达之前一直被持有，0表示关闭
+  // 需在连接的loop线程中调用
+  void setZeroCopyThreshold(size_t threshold);
+  int64_t zeroCopySends() const { return zeroCopySends_; }
+  int64_t zeroCopyCompletions() const { return zeroCopyCompletions_; }
+  int64_t zeroCopyCopied() const { return zeroCopyCopied_; } // 内核退化为拷贝的次数，例如loopback
+  size_t zeroCopyPinnedBlocks() const { return zeroCopyPinned_.size(); }
+
+  bool hasPendingOutput() const { return outputBytes() > 0 || !pendingSegments_.empty(); }
+
   void connectEstablished();
   void connectDestroyed();
   void forceClose();
@@ -60,18 +111,58 @@ private:
   void setState(StateE state) { stat_ = state; }
 
   void handleRead(Timestamp receiveTime);
+  ssize_t readOnce(Timestamp receiveTime, bool *drained);
   void handleWrite();
+  ssize_t flushOutput();
+  void flushStaged();
   void handleClose();
   void handleError();
 
   void sendInLoop(const void *message, size_t len);
+  // owner持有[message, message+len)，没写完的部分可以直接换入outputBuffer_
+  void sendInLoop(const void *message, size_t len, Buffer *owner);
+  void scheduleBufferShrink();
+  void shrinkIdleBuffers();
+  void sendFileInLoop(int fd, off_t offset, size_t length);
+  void sendBlockInLoop(const SharedBlock &block);
+  // send(std::string &&)在调用者的线程中判断，阈值可能同时被修改
+  bool useZeroCopy(size_t len) const
+  {
+    size_t threshold = zeroCopyThreshold_.load(std::memory_order_relaxed);
+    return threshold > 0 && len >= threshold;
+  }
+  void handleZeroCopyCompletions();
+  void appendOutput(const char *data, size_t len);
+  ssize_t writeOutput(int *saveErrno);
+  ssize_t writeBuffer(int *saveErrno, size_t maxBytes);
   void shutdownInLoop();
 
+  // 读暂停的原因，任何一个原因存在都不读该连接
+  enum ReadPauseReason
+  {
+    kPausedByUser = 1,      // stopRead
+    kPausedByWaterMark = 2, // 发送缓冲区超过高水位
+    kPausedByBudget = 4     // loop的缓冲区总量超过内存预算
+  };
+  void startReadInLoop();
+  void stopReadInLoop();
+  void pauseRead(int reason);
+  void resumeRead(int reason);
+  void updateReading();
+  void checkLowWaterMark();
+  void updateBufferAccounting(); // 把缓冲区大小的变化计入loop的内存预算
+
+  void setIdleTimeoutInLoop(int seconds);
+  void touchIdleTimeout();
+  void cancelIdleTimeout();
+  void handleIdleTimeout();
+
 private:
   EventLoop *loop_;
   const std::string name_;
   std::atomic_int stat_;
-  bool reading_;
+  std::atomic_bool reading_;
+  const bool lowFootprint_;
 
   std::unique_ptr<Socket> socket_;
   std::unique_ptr<Channel> channel_;
@@ -83,9 +174,46 @@ private:
   MessageCallback messageCallback_;
   WriteCompleteCallback writeCompleteCallback_;
   HighWaterMarkCallback highWaterMarkCallback_;
+  LowWaterMarkCallback lowWaterMarkCallback_;
   CloseCallback closeCallback_;
   size_t highWaterMark_;
+  size_t lowWaterMark_;
+  bool autoPauseRead_; // 超过高水位自动停止读
+  int readPause_;      // ReadPauseReason的组合
+  size_t accountedBytes_; // 已经计入loop内存预算的缓冲区字节数
 
   Buffer inputBuffer_;
   Buffer outputBuffer_;
+  AdaptiveReadSize readSize_; // 预测下一次read的大小，调整inputBuffer_的可写空间
+  Timestamp lastBufferActivity_; // 最近一次读写缓冲区的时间，用于空闲收缩
+  bool shrinkScheduled_;
+  bool chainedOutput_;
+  ChainBuffer outputChain_;
+
+  // 不经过发送缓冲区的数据段：sendfile发送的文件区间，或者MSG_ZEROCOPY发送的数据块
+  // bytesBefore是发送该段之前还要从发送缓冲区写出的字节数（从上一个段之后开始算）
+  struct PendingSegment
+  {
+    size_t bytesBefore;
+    int fd; // 文件fd，-1表示block
+    off_t offset;
+    size_t remaining;
+    SharedBlock block;
+  };
+  void queueSegment(PendingSegment segment);
+  std::list<PendingSegment> pendingSegments_;
+  size_t segmentsBufferedBytes_; // 所有pendingSegments_的bytesBefore之和
+
+  // MSG_ZEROCOPY：每次成功的send占用一个序号，完成通知按序号区间返回
+  std::atomic<size_t> zeroCopyThreshold_;
+  uint32_t zeroCopyNextId_;
+  std::list<std::pair<uint32_t, SharedBlock>> zeroCopyPinned_; // 等待完成通知的数据块
+  int64_t zeroCopySends_;
+  int64_t zeroCopyCompletions_;
+  int64_t zeroCopyCopied_;
+
+  bool flushQueued_; // 暂存的数据已经交给loop在迭代结束时写出
+
+  int idleTimeoutSeconds_;
+  TimingWheel::Entry idleEntry_; // 挂在loop的时间轮上
 };
\ No newline at end of file
@@ -19,7 +19,7 @@ TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr, const std::
       name_(nameArg),
       acceptor_(new Acceptor(loop, listenAddr, option = kReusePort)), // 负责接收连接的mainloop
       threadPool_(new EventLoopThreadPool(loop, name_)),
-      connectionCallback_(), messageCallback_(), nextConnId_(1), started_(0)
+      connectionCallback_(), messageCallback_(), started_(0), nextConnId_(1), lowFootprint_(false), edgeTriggered_(false)
 {
   acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
 }
@@ -68,7 +68,7 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
 
   InetAddress localAddr(local);
 
-  TcpConnectionPtr conn(new TcpConnection(ioLoop, connName, sockfd, localAddr, peerAddr));
+  TcpConnectionPtr conn(new TcpConnection(ioLoop, connName, sockfd, localAddr, peerAddr, lowFootprint_));
 
   connections_[connName] = conn;
 
@@ -77,6 +77,10 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
   conn->setWriteCompleteCallback(writeCompleteCallback_);
 
   conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
+  if (edgeTriggered_)
+  {
+    conn->setEdgeTriggered(true);
+  }
 
   ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
 }
@@ -33,9 +33,16 @@ public:
   void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
 
   void setThreadNum(int numThreads);
+  // 新连接使用lowFootprint模式，缓冲区按需分配，见TcpConnection
+  void setLowFootprint(bool on) { lowFootprint_ = on; }
+  // 新连接使用边缘触发模式，见TcpConnection::setEdgeTriggered
+  void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
 
   void start();
 
+  // 用于汇总各个loop的统计等
+  std::shared_ptr<EventLoopThreadPool> threadPool() { return threadPool_; }
+
 private:
   void newConnection(int sockfd, const InetAddress &peerAddr);
   void removeConnection(const TcpConnectionPtr &conn);
@@ -56,5 +63,7 @@ private:
   std::atomic_int started_;
 
   int nextConnId_;
+  bool lowFootprint_;
+  bool edgeTriggered_;
   ConnectionMap connections_;
 };
\ No newline at end of file
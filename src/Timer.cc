@@ -2,14 +2,25 @@
 
 std::atomic<int64_t> Timer::s_numCreated_;
 
-void Timer::restart(Timestamp now)
+void Timer::restart(TimePoint now)
 {
-  if (repeat_)
+  if (repeat())
   {
-    expiration_ = addTime(now, interval_);
+    setExpiration(now + interval_);
   }
   else
   {
-    expiration_ = Timestamp();
+    setExpiration(TimePoint());
   }
-}
\ No newline at end of file
+}
+
+int64_t Timer::alignDeadline(int64_t nanoSeconds, int64_t slackNs)
+{
+  if (slackNs <= 0)
+  {
+    return nanoSeconds;
+  }
+  // 不同的2的幂对齐的边界是嵌套的，slack不同的定时器也能落在同一个边界上
+  int64_t granularity = int64_t(1) << (63 - __builtin_clzll(static_cast<uint64_t>(slackNs)));
+  return (nanoSeconds + granularity - 1) & ~(granularity - 1);
+}
@@ -1,20 +1,36 @@
 #pragma once
 
 #include "Callbacks.h"
-#include "Timestamp.h"
+#include "Clock.h"
 #include "nocopyable.h"
 #include <atomic>
 
+// 定时器由TimerQueue的空闲链表复用，不会被释放，过期的TimerId用sequence区分
+// slack为允许推迟执行的时间，实际的触发时间deadline是到期时间按不超过slack的2的幂向上取整，
+// slack相近的定时器落在同一个边界上，共用一次timerfd设置
 class Timer : nocopyable
 {
 public:
-  Timer(TimerCallbck cb, Timestamp when, int interval)
-      : callback_(std::move(cb)),
-        expiration_(when),
-        interval_(interval),
-        repeat_(interval_ > 0),
-        sequence_(++s_numCreated_)
+  using TimePoint = MonotonicClock::time_point;
+  using Duration = MonotonicClock::duration;
+
+  Timer(TimerCallbck cb, TimePoint when, Duration interval, Duration slack)
+      : heapIndex_(-1),
+        canceled_(false),
+        nextFree_(nullptr)
+  {
+    reset(std::move(cb), when, interval, slack);
+  }
+
+  // 复用时重新设置，sequence每次都不同
+  void reset(TimerCallbck cb, TimePoint when, Duration interval, Duration slack)
   {
+    callback_ = std::move(cb);
+    interval_ = interval;
+    slack_ = slack;
+    setExpiration(when);
+    canceled_ = false;
+    sequence_ = ++s_numCreated_;
   }
 
   void run() const
@@ -22,18 +38,41 @@ public:
     callback_();
   }
 
-  Timestamp expiration() const { return expiration_; }
-  bool repeat() const { return repeat_; }
+  TimePoint expiration() const { return expiration_; }
+  TimePoint deadline() const { return deadline_; } // 加上slack对齐之后的触发时间
+  bool repeat() const { return interval_.count() > 0; }
   int64_t sequence() const { return sequence_; }
-  void restart(Timestamp now);
+  void restart(TimePoint now);
   static int64_t numCreated() { return s_numCreated_; }
+  // 把纳秒时间按不超过slack的2的幂向上取整
+  static int64_t alignDeadline(int64_t nanoSeconds, int64_t slackNs);
+
+  // 以下由TimerQueue使用
+  int heapIndex() const { return heapIndex_; } // 在堆中的下标，不在堆中为-1
+  void setHeapIndex(int index) { heapIndex_ = index; }
+  // 其他线程添加的定时器在插入堆之前就被取消了
+  bool canceled() const { return canceled_; }
+  void setCanceled() { canceled_ = true; }
+  Timer *nextFree() const { return nextFree_; }
+  void setNextFree(Timer *next) { nextFree_ = next; }
+  void releaseCallback() { callback_ = nullptr; } // 放回空闲链表时释放回调持有的对象
 
 private:
-  const TimerCallbck callback_;
-  Timestamp expiration_;
-  const int interval_;
-  const bool repeat_;
-  const int64_t sequence_;
+  void setExpiration(TimePoint when)
+  {
+    expiration_ = when;
+    deadline_ = TimePoint(Duration(alignDeadline(when.time_since_epoch().count(), slack_.count())));
+  }
+
+  TimerCallbck callback_;
+  TimePoint expiration_;
+  TimePoint deadline_;
+  Duration interval_; // 重复的间隔，0表示只执行一次
+  Duration slack_;
+  int64_t sequence_;
+  int heapIndex_;
+  bool canceled_;
+  Timer *nextFree_;
 
   static std::atomic<int64_t> s_numCreated_;
-};
\ No newline at end of file
+};
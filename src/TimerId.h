@@ -3,6 +3,7 @@
 
 class Timer;
 
+// 用于取消定时器，定时器执行完或被取消后再取消是无害的
 class TimerId : public copyable
 {
 public:
@@ -3,9 +3,12 @@
 #include "TimerQueue.h"
 #include "Logger.h"
 #include "EventLoop.h"
+#include "LoopStats.h"
+#include "Tracer.h"
 #include <sys/timerfd.h>
 #include <unistd.h>
 #include <strings.h>
+#include <errno.h>
 #include <algorithm>
 
 int createTimerfd()
@@ -18,37 +21,39 @@ int createTimerfd()
   return timerfd;
 }
 
-struct timespec howMuchTimeFromNow(Timestamp when)
-{
-  int64_t microseconds = when.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch();
-  if (microseconds < 100)
-    microseconds = 100;
-
-  struct timespec ts;
-  ts.tv_sec = microseconds / Timestamp::kMicroSecondsPerSecond;
-  ts.tv_nsec = (microseconds % Timestamp::kMicroSecondsPerSecond) * 1000;
-
-  return ts;
-}
-
-void readTimerfd(int timerfd, Timestamp now)
+void readTimerfd(int timerfd)
 {
   uint64_t count;
   ssize_t n = ::read(timerfd, &count, sizeof(count));
-  LOG_INFO("TimerQueue::handleread, timer called %ld times at %s", count, now.toString().c_str());
+  LOG_INFO("TimerQueue::handleread, timer called %ld times", count);
 }
 
-void resetTimerfd(int timerfd, Timestamp expiration)
+// 以CLOCK_MONOTONIC上的绝对时间设置，已经过去的时间立即触发，不需要先计算相对时间
+// 早于开机时间的墙上时间换算后是负数，全0又表示停止计时，都按1ns处理
+bool resetTimerfd(int timerfd, Timer::TimePoint expiration)
 {
+  int64_t ns = std::max<int64_t>(expiration.time_since_epoch().count(), 1);
   struct itimerspec newValue;
-  struct itimerspec oldValue;
   bzero(&newValue, sizeof(newValue));
-  bzero(&oldValue, sizeof(oldValue));
-  newValue.it_value = howMuchTimeFromNow(expiration);
-  ::timerfd_settime(timerfd, 0, &newValue, &oldValue);
+  newValue.it_value.tv_sec = ns / (1000 * 1000 * 1000);
+  newValue.it_value.tv_nsec = ns % (1000 * 1000 * 1000);
+  if (::timerfd_settime(timerfd, TFD_TIMER_ABSTIME, &newValue, nullptr) < 0)
+  {
+    LOG_ERROR("timerfd_settime failed: %d", errno)
+    return false;
+  }
+  return true;
 }
 
-TimerQueue::TimerQueue(EventLoop *loop) : loop_(loop), timerfd_(createTimerfd()), timerfdChannel_(loop, timerfd_)
+TimerQueue::TimerQueue(EventLoop *loop)
+    : loop_(loop),
+      timerfd_(createTimerfd()),
+      timerfdChannel_(loop, timerfd_),
+      freeList_(nullptr),
+      runningTimer_(nullptr),
+      runningTimerCanceled_(false),
+      usePollTimeout_(false),
+      arms_(0)
 {
   timerfdChannel_.setReadCallback(std::bind(&TimerQueue::handleRead, this));
   timerfdChannel_.enableReading();
@@ -59,75 +64,294 @@ TimerQueue::~TimerQueue()
   timerfdChannel_.disableAll();
   timerfdChannel_.remove();
   ::close(timerfd_);
+  for (Timer *timer : heap_)
+  {
+    delete timer;
+  }
+  while (freeList_)
+  {
+    Timer *next = freeList_->nextFree();
+    delete freeList_;
+    freeList_ = next;
+  }
 }
 
-TimerId TimerQueue::addTimer(TimerCallbck cb, Timestamp when, int interval)
+TimerId TimerQueue::addTimer(TimerCallbck cb, Timer::TimePoint when, Timer::Duration interval, Timer::Duration slack)
 {
-  Timer *timer = new Timer(std::move(cb), when, interval);
-  loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer));
-  return TimerId(timer, timer->sequence());
+  if (loop_->isInLoopThread())
+  {
+    Timer *timer = allocTimer(std::move(cb), when, interval, slack);
+    addTimerInLoop(timer);
+    return TimerId(timer, timer->sequence());
+  }
+  // 其他线程不能访问空闲链表，新建的Timer在loop线程中插入，以后被回收到空闲链表中
+  Timer *timer = new Timer(std::move(cb), when, interval, slack);
+  // 投递之后timer可能已经在loop线程中执行完并被复用，序号要在投递之前取出
+  int64_t sequence = timer->sequence();
+  loop_->queueInLoop([this, timer]()
+                     { addTimerInLoop(timer); });
+  return TimerId(timer, sequence);
+}
+
+void TimerQueue::cancel(TimerId timerId)
+{
+  Timer *timer = timerId.timer_;
+  int64_t sequence = timerId.sequence_;
+  if (!timer)
+  {
+    return;
+  }
+  if (loop_->isInLoopThread())
+  {
+    cancelInLoop(timer, sequence);
+  }
+  else
+  {
+    loop_->queueInLoop([this, timer, sequence]()
+                       { cancelInLoop(timer, sequence); });
+  }
 }
 
 void TimerQueue::addTimerInLoop(Timer *timer)
 {
-  bool erliestChanged = insert(timer);
-  if (erliestChanged)
+  if (timer->canceled())
   {
-    resetTimerfd(timerfd_, timer->expiration());
+    freeTimer(timer);
+    return;
+  }
+  heapPush(timer);
+  // 最早的触发时间变了
+  if (timer->heapIndex() == 0)
+  {
+    armTimerfd();
   }
 }
 
-void TimerQueue::reset(const std::vector<Entry> &expired, Timestamp now)
+void TimerQueue::cancelInLoop(Timer *timer, int64_t sequence)
 {
-  Timestamp nextExpire;
-  for (const Entry &it : expired)
+  // Timer不会被释放，sequence不同说明已经执行完或被取消，Timer被复用了
+  if (timer->sequence() != sequence)
+  {
+    return;
+  }
+  if (timer->heapIndex() >= 0)
   {
-    delete it.second;
+    // 最早的定时器被取消时不重设timerfd，多余的一次唤醒在handleRead中什么也不做
+    heapRemove(timer);
+    freeTimer(timer);
   }
-  if (!timers_.empty())
+  else if (timer == runningTimer_)
   {
-    nextExpire = timers_.begin()->second->expiration();
+    runningTimerCanceled_ = true;
   }
-  if (nextExpire.microSecondsSinceEpoch() > 0)
+  else
   {
-    resetTimerfd(timerfd_, nextExpire);
+    // 还没插入堆（添加的回调还在队列中），插入时丢弃；已经执行完放回空闲链表的，复用时会清掉这个标记
+    timer->setCanceled();
   }
 }
 
-bool TimerQueue::insert(Timer *timer)
+void TimerQueue::handleRead()
 {
-  bool erliestChanged = false;
-  Timestamp when = timer->expiration();
-  TimerList::iterator it = timers_.begin();
-  if (it == timers_.end() || when < it->first)
+  readTimerfd(timerfd_);
+  armedAt_ = Timer::TimePoint(); // timerfd是单次的，触发后就不再设置
+  processExpired(MonotonicClock::now());
+  armTimerfd();
+}
+
+void TimerQueue::processExpired(Timer::TimePoint now)
+{
+  // 每次取出最早的一个执行，回调中取消其他已经到期的定时器也能生效
+  while (!heap_.empty() && !(now < heap_[0]->deadline()))
   {
-    erliestChanged = true;
+    Timer *timer = heap_[0];
+    heapRemove(timer);
+    runningTimer_ = timer;
+    runningTimerCanceled_ = false;
+    loop_->stats()->recordTimerLag(std::chrono::duration_cast<std::chrono::microseconds>(MonotonicClock::now() - timer->expiration()).count());
+    {
+      TraceSpan span("timer");
+      timer->run();
+    }
+    runningTimer_ = nullptr;
+    if (timer->repeat() && !runningTimerCanceled_)
+    {
+      timer->restart(now);
+      heapPush(timer);
+    }
+    else
+    {
+      freeTimer(timer);
+    }
   }
+}
 
-  timers_.insert(Entry(when, timer));
-  return erliestChanged;
+// 已经设置的时间不晚于最早的触发时间时什么也不做，最早的定时器被取消后多余的一次触发在handleRead中重新设置
+void TimerQueue::armTimerfd()
+{
+  if (usePollTimeout_ || heap_.empty())
+  {
+    return;
+  }
+  Timer::TimePoint deadline = heap_[0]->deadline();
+  if (armedAt_ != Timer::TimePoint() && !(deadline < armedAt_))
+  {
+    return;
+  }
+  ++arms_;
+  // 设置失败时不记录，下次还会重新设置
+  if (resetTimerfd(timerfd_, deadline))
+  {
+    armedAt_ = deadline;
+  }
 }
 
-void TimerQueue::handleRead()
+void TimerQueue::setUsePollTimeout(bool on)
+{
+  usePollTimeout_ = on;
+  if (on && armedAt_ != Timer::TimePoint())
+  {
+    struct itimerspec newValue;
+    bzero(&newValue, sizeof(newValue));
+    ::timerfd_settime(timerfd_, 0, &newValue, nullptr);
+    ++arms_;
+    armedAt_ = Timer::TimePoint();
+  }
+  else if (!on)
+  {
+    armTimerfd();
+  }
+}
+
+int TimerQueue::pollTimeoutMs(int timeoutMs) const
+{
+  if (!usePollTimeout_ || heap_.empty())
+  {
+    return timeoutMs;
+  }
+  int64_t ns = (heap_[0]->deadline() - MonotonicClock::now()).count();
+  if (ns <= 0)
+  {
+    return 0;
+  }
+  // 向上取整，不会提前返回
+  int64_t ms = (ns + 999999) / 1000000;
+  return timeoutMs >= 0 && ms > timeoutMs ? timeoutMs : static_cast<int>(ms);
+}
+
+void TimerQueue::expireTimers()
+{
+  if (!usePollTimeout_ || heap_.empty())
+  {
+    return;
+  }
+  Timer::TimePoint now = MonotonicClock::now();
+  if (!(now < heap_[0]->deadline()))
+  {
+    processExpired(now);
+  }
+}
+
+Timer *TimerQueue::allocTimer(TimerCallbck cb, Timer::TimePoint when, Timer::Duration interval, Timer::Duration slack)
 {
-  Timestamp now(Timestamp::now());
-  readTimerfd(timerfd_, now);
-  std::vector<Entry> expired = getExpired(now);
-  callingExpiredTimers_ = true;
-  for (const Entry &it : expired)
+  if (!freeList_)
   {
-    it.second->run();
+    return new Timer(std::move(cb), when, interval, slack);
   }
-  callingExpiredTimers_ = false;
-  reset(expired, now);
+  Timer *timer = freeList_;
+  freeList_ = timer->nextFree();
+  timer->setNextFree(nullptr);
+  timer->reset(std::move(cb), when, interval, slack);
+  return timer;
 }
 
-std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now)
+void TimerQueue::freeTimer(Timer *timer)
 {
-  std::vector<Entry> expired;
-  Entry sentry(now, reinterpret_cast<Timer *>(UINTPTR_MAX));
-  TimerList::iterator end = timers_.lower_bound(sentry);
-  std::copy(timers_.begin(), end, std::back_inserter(expired));
-  timers_.erase(timers_.begin(), end);
-  return expired;
+  timer->releaseCallback();
+  timer->setNextFree(freeList_);
+  freeList_ = timer;
+}
+
+// 触发时间相同时先添加的先执行
+bool TimerQueue::earlier(const Timer *lhs, const Timer *rhs)
+{
+  if (lhs->deadline() == rhs->deadline())
+  {
+    return lhs->sequence() < rhs->sequence();
+  }
+  return lhs->deadline() < rhs->deadline();
+}
+
+void TimerQueue::place(Timer *timer, int index)
+{
+  heap_[index] = timer;
+  timer->setHeapIndex(index);
+}
+
+void TimerQueue::heapPush(Timer *timer)
+{
+  heap_.push_back(timer);
+  timer->setHeapIndex(static_cast<int>(heap_.size()) - 1);
+  siftUp(timer->heapIndex());
+}
+
+void TimerQueue::heapRemove(Timer *timer)
+{
+  int index = timer->heapIndex();
+  Timer *last = heap_.back();
+  heap_.pop_back();
+  timer->setHeapIndex(-1);
+  if (last != timer)
+  {
+    // 用最后一个元素填补空位，再向上或向下调整
+    place(last, index);
+    siftUp(index);
+    siftDown(last->heapIndex());
+  }
+}
+
+void TimerQueue::siftUp(int index)
+{
+  Timer *timer = heap_[index];
+  while (index > 0)
+  {
+    int parent = (index - 1) / kArity;
+    if (!earlier(timer, heap_[parent]))
+    {
+      break;
+    }
+    place(heap_[parent], index);
+    index = parent;
+  }
+  place(timer, index);
+}
+
+void TimerQueue::siftDown(int index)
+{
+  Timer *timer = heap_[index];
+  int size = static_cast<int>(heap_.size());
+  while (true)
+  {
+    int first = index * kArity + 1;
+    if (first >= size)
+    {
+      break;
+    }
+    int last = std::min(first + kArity, size);
+    int child = first;
+    for (int i = first + 1; i < last; ++i)
+    {
+      if (earlier(heap_[i], heap_[child]))
+      {
+        child = i;
+      }
+    }
+    if (!earlier(heap_[child], timer))
+    {
+      break;
+    }
+    place(heap_[child], index);
+    index = child;
+  }
+  place(timer, index);
 }
@@ -1,39 +1,65 @@
 #pragma once
 #include "Callbacks.h"
-#include "Timestamp.h"
+#include "Timer.h"
 #include "Channel.h"
-#include <set>
 #include <vector>
 
 class EventLoop;
-class Timer;
 class TimerId;
 
+// 定时器按触发时间（见Timer::deadline）放在带下标的4叉堆中，每个Timer记录自己在堆中的位置，插入、取消都是O(log n)
+// 到期时间使用单调时钟，timerfd以绝对时间设置
+// Timer从空闲链表分配，在loop线程中添加、取消定时器不分配内存也不需要跨线程投递
+// timerfd已经设置的时间不晚于最早的触发时间时不再重新设置，落在同一个slack边界上的定时器共用一次设置
 class TimerQueue : nocopyable
 {
 public:
   explicit TimerQueue(EventLoop *loop);
   ~TimerQueue();
 
-  TimerId addTimer(TimerCallbck cb, Timestamp when, int interval);
+  // interval大于0时为重复定时器，slack为允许推迟执行的时间，可以在任意线程调用
+  TimerId addTimer(TimerCallbck cb, Timer::TimePoint when, Timer::Duration interval, Timer::Duration slack);
+  void cancel(TimerId timerId);
+
+  size_t size() const { return heap_.size(); }
+  int64_t arms() const { return arms_; } // timerfd_settime的调用次数
+
+  // 不使用timerfd：EventLoop把最早的触发时间折算进poll的超时（向上取整到毫秒），poll返回后调用expireTimers
+  // 只能在loop线程中调用
+  void setUsePollTimeout(bool on);
+  bool usingPollTimeout() const { return usePollTimeout_; }
+  int pollTimeoutMs(int timeoutMs) const;
+  void expireTimers();
 
 private:
-  using Entry = std::pair<Timestamp, Timer *>;
-  using TimerList = std::set<Entry>;
-  using ActiveTimer = std::pair<Timer *, int64_t>; // 用于cancel
-  using ActiveTimerSet = std::set<ActiveTimer>;    // 用于cancel
+  static const int kArity = 4;
 
   void addTimerInLoop(Timer *timer);
-  void reset(const std::vector<Entry> &expired, Timestamp now);
-  bool insert(Timer *timer);
+  void cancelInLoop(Timer *timer, int64_t sequence);
   void handleRead();
-  std::vector<Entry> getExpired(Timestamp now);
+  void processExpired(Timer::TimePoint now);
+  void armTimerfd();
+
+  Timer *allocTimer(TimerCallbck cb, Timer::TimePoint when, Timer::Duration interval, Timer::Duration slack);
+  void freeTimer(Timer *timer);
+
+  // 堆操作
+  static bool earlier(const Timer *lhs, const Timer *rhs);
+  void heapPush(Timer *timer);
+  void heapRemove(Timer *timer);
+  void siftUp(int index);
+  void siftDown(int index);
+  void place(Timer *timer, int index);
 
 private:
   EventLoop *loop_;
   const int timerfd_;
   Channel timerfdChannel_;
-  TimerList timers_;
-  ActiveTimerSet activeTimers_;
-  std::atomic_bool callingExpiredTimers_;
-};
\ No newline at end of file
+  std::vector<Timer *> heap_;
+  Timer *freeList_;
+  Timer *runningTimer_;       // 正在执行回调的定时器
+  bool runningTimerCanceled_; // 回调中取消了正在执行的重复定时器
+  Timer::TimePoint armedAt_;  // timerfd设置的触发时间，没有设置时为0
+  bool usePollTimeout_;
+  int64_t arms_;
+};
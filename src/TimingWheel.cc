@@ -0,0 +1,174 @@
+#include "TimingWheel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <strings.h>
+
+static int createWheelTimerfd()
+{
+  int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timerfd < 0)
+  {
+    LOG_ERROR("TimingWheel: failed in timerfd_create")
+  }
+  return timerfd;
+}
+
+TimingWheel::TimingWheel(EventLoop *loop, int tickMs, int numSlots)
+    : loop_(loop),
+      tickMs_(tickMs > 0 ? tickMs : kDefaultTickMs),
+      numSlots_(numSlots > 0 ? numSlots : kDefaultNumSlots),
+      timerfd_(createWheelTimerfd()),
+      timerfdChannel_(loop, timerfd_),
+      slots_(new Entry[numSlots_]),
+      currentTick_(0),
+      size_(0),
+      ticking_(false),
+      expiredCount_(0)
+{
+  for (int i = 0; i < numSlots_; ++i)
+  {
+    slots_[i].prev_ = &slots_[i];
+    slots_[i].next_ = &slots_[i];
+  }
+  timerfdChannel_.setReadCallback(std::bind(&TimingWheel::handleRead, this));
+  timerfdChannel_.enableReading();
+}
+
+TimingWheel::~TimingWheel()
+{
+  // 剩下的节点属于各自的对象，只解除链接
+  for (int i = 0; i < numSlots_; ++i)
+  {
+    Entry *head = &slots_[i];
+    while (head->next_ != head)
+    {
+      unlink(head->next_);
+    }
+  }
+  timerfdChannel_.disableAll();
+  timerfdChannel_.remove();
+  ::close(timerfd_);
+}
+
+void TimingWheel::arm(Entry *entry, int timeoutMs)
+{
+  if (entry->linked())
+  {
+    unlink(entry);
+  }
+  entry->timeoutTicks_ = timeoutMs > tickMs_ ? (timeoutMs + tickMs_ - 1) / tickMs_ : 1;
+  refresh(entry);
+  link(entry);
+  if (!ticking_)
+  {
+    startTicking(true);
+  }
+}
+
+void TimingWheel::cancel(Entry *entry)
+{
+  if (entry->linked())
+  {
+    unlink(entry);
+    if (size_ == 0)
+    {
+      startTicking(false);
+    }
+  }
+}
+
+void TimingWheel::link(Entry *entry)
+{
+  Entry *head = &slots_[entry->deadlineTick_ % numSlots_];
+  entry->prev_ = head->prev_;
+  entry->next_ = head;
+  head->prev_->next_ = entry;
+  head->prev_ = entry;
+  ++size_;
+}
+
+void TimingWheel::unlink(Entry *entry)
+{
+  entry->prev_->next_ = entry->next_;
+  entry->next_->prev_ = entry->prev_;
+  entry->prev_ = nullptr;
+  entry->next_ = nullptr;
+  --size_;
+}
+
+void TimingWheel::startTicking(bool on)
+{
+  struct itimerspec value;
+  bzero(&value, sizeof(value));
+  if (on)
+  {
+    value.it_value.tv_sec = tickMs_ / 1000;
+    value.it_value.tv_nsec = (tickMs_ % 1000) * 1000 * 1000;
+    value.it_interval = value.it_value;
+  }
+  ::timerfd_settime(timerfd_, 0, &value, nullptr);
+  ticking_ = on;
+}
+
+void TimingWheel::handleRead()
+{
+  uint64_t count = 0;
+  ssize_t n = ::read(timerfd_, &count, sizeof(count));
+  if (n != sizeof(count))
+  {
+    return;
+  }
+  // loop被阻塞时可能错过了多个tick，逐个补上
+  for (uint64_t i = 0; i < count && ticking_; ++i)
+  {
+    tick();
+  }
+}
+
+void TimingWheel::tick()
+{
+  ++currentTick_;
+  Entry *head = &slots_[currentTick_ % numSlots_];
+  if (head->next_ == head)
+  {
+    return;
+  }
+
+  // 把整个槽摘到临时链表上再处理，回调中arm/cancel其他节点都是安全的
+  Entry pending;
+  pending.next_ = head->next_;
+  pending.prev_ = head->prev_;
+  pending.next_->prev_ = &pending;
+  pending.prev_->next_ = &pending;
+  head->next_ = head;
+  head->prev_ = head;
+
+  while (pending.next_ != &pending)
+  {
+    Entry *entry = pending.next_;
+    entry->prev_->next_ = entry->next_;
+    entry->next_->prev_ = entry->prev_;
+    --size_;
+    if (entry->deadlineTick_ > currentTick_)
+    {
+      // 期间被refresh过，挂到新deadline对应的槽上
+      link(entry);
+      continue;
+    }
+    entry->prev_ = nullptr;
+    entry->next_ = nullptr;
+    ++expiredCount_;
+    if (entry->callback_)
+    {
+      entry->callback_();
+    }
+  }
+
+  if (size_ == 0 && ticking_)
+  {
+    startTicking(false);
+  }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "nocopyable.h"
+#include "Channel.h"
+
+#include <functional>
+#include <memory>
+#include <stdint.h>
+
+class EventLoop;
+
+// 每个EventLoop一个的哈希时间轮，用于大量连接的空闲超时
+// 时间轮由numSlots个槽组成，每tick毫秒前进一格，节点挂在deadline % numSlots的槽上
+// 节点嵌入在被管理的对象中，arm/refresh/cancel都是O(1)且不分配内存：
+// refresh只更新deadline，不移动节点，等到节点所在的槽到期时再检查，未到期就重新挂到deadline对应的槽上
+// 同一个tick到期的节点成批处理
+class TimingWheel : nocopyable
+{
+public:
+  class Entry : nocopyable
+  {
+  public:
+    using ExpireCallback = std::function<void()>;
+
+    Entry() : prev_(nullptr), next_(nullptr), timeoutTicks_(0), deadlineTick_(0) {}
+    explicit Entry(ExpireCallback cb) : Entry() { callback_ = std::move(cb); }
+
+    void setExpireCallback(ExpireCallback cb) { callback_ = std::move(cb); }
+    bool linked() const { return prev_ != nullptr; }
+
+  private:
+    friend class TimingWheel;
+
+    Entry *prev_;
+    Entry *next_;
+    int64_t timeoutTicks_;
+    int64_t deadlineTick_;
+    ExpireCallback callback_;
+  };
+
+  static const int kDefaultTickMs = 1000;
+  static const int kDefaultNumSlots = 512;
+
+  TimingWheel(EventLoop *loop, int tickMs = kDefaultTickMs, int numSlots = kDefaultNumSlots);
+  ~TimingWheel();
+
+  // 以下接口只能在loop线程中调用
+  // entry在timeoutMs毫秒（向上取整到tick）内没有refresh则回调其ExpireCallback
+  // tick是周期性的，当前tick已经过去了一部分，deadline多加一个tick，保证不会提前到期，最多晚一个tick
+  void arm(Entry *entry, int timeoutMs);
+  void refresh(Entry *entry) { entry->deadlineTick_ = currentTick_ + entry->timeoutTicks_ + 1; }
+  void cancel(Entry *entry);
+
+  int tickMs() const { return tickMs_; }
+  size_t size() const { return size_; }
+  int64_t expiredCount() const { return expiredCount_; }
+
+private:
+  void handleRead();
+  void tick();
+  void link(Entry *entry);
+  void unlink(Entry *entry);
+  void startTicking(bool on);
+
+  EventLoop *loop_;
+  const int tickMs_;
+  const int numSlots_;
+  const int timerfd_;
+  Channel timerfdChannel_;
+  std::unique_ptr<Entry[]> slots_; // 每个槽是一个带哨兵的双向循环链表
+  int64_t currentTick_;
+  size_t size_;
+  bool ticking_;
+  int64_t expiredCount_;
+};
@@ -0,0 +1,176 @@
+#include "Tracer.h"
+#include "LoopStats.h"
+#include "CurrentThread.h"
+#include "Logger.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic_bool Tracer::enabled_(false);
+
+namespace
+{
+  struct TraceEvent
+  {
+    std::atomic<const char *> name;
+    std::atomic<int64_t> beginNs;
+    std::atomic<int64_t> durationNs;
+    std::atomic<int64_t> arg;
+  };
+
+  // 单个线程的环形缓冲区，head为写入的总条数，start为clear时的head，只由导出方修改
+  // dead表示线程已经退出，不会再写入
+  struct TraceRing
+  {
+    explicit TraceRing(int threadId) : tid(threadId), head(0), start(0), dead(false), events(new TraceEvent[Tracer::kRingSize]) {}
+
+    const int tid;
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> start;
+    std::atomic_bool dead;
+    std::unique_ptr<TraceEvent[]> events;
+  };
+
+  // 线程退出后记录仍然保留，导出或clear之后释放
+  std::mutex g_ringsMutex;
+  std::vector<std::shared_ptr<TraceRing>> g_rings;
+
+  __thread TraceRing *t_ring = nullptr;
+
+  // 线程退出时把自己的环形缓冲区标记为dead
+  struct RingOwner
+  {
+    ~RingOwner()
+    {
+      if (ring)
+      {
+        t_ring = nullptr;
+        ring->dead.store(true, std::memory_order_release);
+      }
+    }
+    TraceRing *ring = nullptr;
+  };
+  thread_local RingOwner t_ringOwner;
+
+  TraceRing *threadRing()
+  {
+    if (__builtin_expect(t_ring == nullptr, 0))
+    {
+      std::shared_ptr<TraceRing> ring(new TraceRing(CurrentThread::tid()));
+      {
+        std::lock_guard<std::mutex> lock(g_ringsMutex);
+        g_rings.push_back(ring);
+      }
+      t_ring = ring.get();
+      t_ringOwner.ring = t_ring;
+    }
+    return t_ring;
+  }
+
+  // 释放已经导出过的、线程已经退出的环形缓冲区
+  void dropRings(const std::vector<std::shared_ptr<TraceRing>> &dead)
+  {
+    if (dead.empty())
+    {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(g_ringsMutex);
+    g_rings.erase(std::remove_if(g_rings.begin(), g_rings.end(), [&dead](const std::shared_ptr<TraceRing> &ring)
+                                 { return std::find(dead.begin(), dead.end(), ring) != dead.end(); }),
+                  g_rings.end());
+  }
+}
+
+void Tracer::record(const char *name, int64_t beginNs, int64_t endNs, int64_t arg)
+{
+  TraceRing *ring = threadRing();
+  uint64_t head = ring->head.load(std::memory_order_relaxed);
+  TraceEvent &event = ring->events[head & (kRingSize - 1)];
+  event.name.store(name, std::memory_order_relaxed);
+  event.beginNs.store(beginNs, std::memory_order_relaxed);
+  event.durationNs.store(endNs - beginNs, std::memory_order_relaxed);
+  event.arg.store(arg, std::memory_order_relaxed);
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+int64_t TraceSpan::now()
+{
+  return LoopStats::nowNanos();
+}
+
+std::string Tracer::dumpJson()
+{
+  std::vector<std::shared_ptr<TraceRing>> rings;
+  {
+    std::lock_guard<std::mutex> lock(g_ringsMutex);
+    rings = g_rings;
+  }
+
+  std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  char buf[256];
+  bool first = true;
+  int pid = ::getpid();
+  std::vector<std::shared_ptr<TraceRing>> dead;
+  for (const std::shared_ptr<TraceRing> &ring : rings)
+  {
+    // 在读head之前确认线程已经退出，这时它的记录都会被导出
+    if (ring->dead.load(std::memory_order_acquire))
+    {
+      dead.push_back(ring);
+    }
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t begin = std::max(head > kRingSize ? head - kRingSize : 0, ring->start.load(std::memory_order_relaxed));
+    for (uint64_t i = begin; i < head; ++i)
+    {
+      const TraceEvent &event = ring->events[i & (kRingSize - 1)];
+      const char *name = event.name.load(std::memory_order_relaxed);
+      int64_t beginNs = event.beginNs.load(std::memory_order_relaxed);
+      int64_t durationNs = event.durationNs.load(std::memory_order_relaxed);
+      int64_t arg = event.arg.load(std::memory_order_relaxed);
+      // 读的过程中被覆盖（或正在被覆盖）的记录丢弃
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (ring->head.load(std::memory_order_relaxed) - i >= kRingSize)
+      {
+        continue;
+      }
+      snprintf(buf, sizeof(buf),
+               "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"arg\":%ld}}",
+               first ? "" : ",", name, pid, ring->tid, beginNs / 1000.0, durationNs / 1000.0, arg);
+      json += buf;
+      first = false;
+    }
+  }
+  json += "\n]}\n";
+  dropRings(dead);
+  return json;
+}
+
+bool Tracer::dump(const std::string &path)
+{
+  std::string json = dumpJson();
+  FILE *fp = ::fopen(path.c_str(), "w");
+  if (!fp)
+  {
+    LOG_ERROR("Tracer::dump open %s failed: %d", path.c_str(), errno)
+    return false;
+  }
+  bool ok = ::fwrite(json.data(), 1, json.size(), fp) == json.size();
+  ::fclose(fp);
+  return ok;
+}
+
+void Tracer::clear()
+{
+  std::lock_guard<std::mutex> lock(g_ringsMutex);
+  g_rings.erase(std::remove_if(g_rings.begin(), g_rings.end(), [](const std::shared_ptr<TraceRing> &ring)
+                               { return ring->dead.load(std::memory_order_acquire); }),
+                g_rings.end());
+  for (const std::shared_ptr<TraceRing> &ring : g_rings)
+  {
+    ring->start.store(ring->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+  }
+}
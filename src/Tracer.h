@@ -0,0 +1,60 @@
+#pragma once
+
+#include "nocopyable.h"
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+// reactor活动的跟踪：记录poll等待、channel事件处理、发送、定时器和投递回调的起止时间，
+// 导出为Chrome trace-event JSON，可以在Perfetto或chrome://tracing中查看
+// 每个线程一个环形缓冲区，只由本线程写入，写满后覆盖最旧的记录，记录时不加锁
+// 关闭时每个埋点只有一次relaxed的原子读和分支
+class Tracer : nocopyable
+{
+public:
+  static const size_t kRingSize = 64 * 1024; // 每个线程保留的记录条数，2的幂
+
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+  // 运行时开关，可以在任意线程调用
+  static void setEnabled(bool on) { enabled_.store(on, std::memory_order_relaxed); }
+
+  // 记录一段[beginNs, endNs]的区间，时间为LoopStats::nowNanos()，name必须是字符串常量，arg为附加的参数（如fd、字节数）
+  static void record(const char *name, int64_t beginNs, int64_t endNs, int64_t arg);
+
+  // 把所有线程的记录导出为JSON，可以在任意线程调用，与记录并发时丢弃正在被覆盖的记录
+  // 已经退出的线程的记录导出之后释放
+  static std::string dumpJson();
+  static bool dump(const std::string &path);
+  // 清空所有线程的记录，同时释放已经退出的线程的缓冲区
+  static void clear();
+
+private:
+  static std::atomic_bool enabled_;
+};
+
+// 作用域内的一段区间，关闭跟踪时只检查一次开关
+class TraceSpan : nocopyable
+{
+public:
+  explicit TraceSpan(const char *name, int64_t arg = 0)
+      : name_(name), arg_(arg), beginNs_(Tracer::enabled() ? now() : 0)
+  {
+  }
+  ~TraceSpan()
+  {
+    if (beginNs_ != 0)
+    {
+      Tracer::record(name_, beginNs_, now(), arg_);
+    }
+  }
+
+  void setArg(int64_t arg) { arg_ = arg; }
+
+private:
+  static int64_t now();
+
+  const char *name_;
+  int64_t arg_;
+  const int64_t beginNs_;
+};